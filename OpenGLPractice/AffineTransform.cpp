@@ -0,0 +1,85 @@
+#include "AffineTransform.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+	float maxDifference(const glm::mat4& a, const glm::mat4& b) {
+		float difference = 0.0f;
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				difference = std::max(difference, std::fabs(a[c][r] - b[c][r]) / std::max(1.0f, std::fabs(b[c][r])));
+		return difference;
+	}
+
+	// (parent * child).inverse() for every pair, then the same through glm::mat4 to check the result
+	template <AffineKind K>
+	double timeKind(const std::vector<Affine<K>>& parents, const std::vector<Affine<K>>& children, unsigned int iterations, float& maxError) {
+		std::vector<Affine<K>> results(parents.size());
+
+		double ms = Benchmark::averageMs(iterations, [&]() {
+			for (size_t i = 0; i < parents.size(); i++)
+				results[i] = (parents[i] * children[i]).inverse();
+		});
+
+		for (size_t i = 0; i < parents.size(); i++)
+			maxError = std::max(maxError, maxDifference(results[i].toMat4(), glm::inverse(parents[i].toMat4() * children[i].toMat4())));
+		return ms;
+	}
+}
+
+AffineBenchmarkResult AffineTransformBenchmark::run(unsigned int transformCount, unsigned int iterations) {
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+	auto randomPosition = [&]() { return Benchmark::randomVec3(random, -50.0f, 50.0f); };
+	auto randomRotation = [&]() { return Benchmark::randomRotation(random); };
+
+	std::vector<TranslationTransform> translations;
+	std::vector<RigidTransform> rigids;
+	std::vector<UniformScaleTransform> uniformScales;
+	std::vector<GeneralTransform> generals;
+	for (unsigned int i = 0; i < 2 * transformCount; i++) {
+		translations.push_back(TranslationTransform(randomPosition()));
+		rigids.push_back(RigidTransform(randomRotation(), randomPosition()));
+		uniformScales.push_back(UniformScaleTransform(randomRotation(), randomPosition(), size(random)));
+		generals.push_back(GeneralTransform::fromTRS(randomPosition(), randomRotation(), Benchmark::randomVec3(random, 0.5f, 2.0f)));
+	}
+
+	AffineBenchmarkResult result;
+	result.transformCount = transformCount;
+	result.maxError = 0.0f;
+
+	// the way it is done without knowing the kind, on the most general inputs
+	std::vector<glm::mat4> parentMatrices, childMatrices, matrixResults(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++) {
+		parentMatrices.push_back(generals[i].toMat4());
+		childMatrices.push_back(generals[transformCount + i].toMat4());
+	}
+	result.mat4Ms = Benchmark::averageMs(iterations, [&]() {
+		for (unsigned int i = 0; i < transformCount; i++)
+			matrixResults[i] = glm::inverse(parentMatrices[i] * childMatrices[i]);
+	});
+
+	auto split = [transformCount](auto& all, auto& parents, auto& children) {
+		parents.assign(all.begin(), all.begin() + transformCount);
+		children.assign(all.begin() + transformCount, all.end());
+	};
+	std::vector<TranslationTransform> translationParents, translationChildren;
+	std::vector<RigidTransform> rigidParents, rigidChildren;
+	std::vector<UniformScaleTransform> uniformParents, uniformChildren;
+	std::vector<GeneralTransform> generalParents, generalChildren;
+	split(translations, translationParents, translationChildren);
+	split(rigids, rigidParents, rigidChildren);
+	split(uniformScales, uniformParents, uniformChildren);
+	split(generals, generalParents, generalChildren);
+
+	result.translationMs = timeKind(translationParents, translationChildren, iterations, result.maxError);
+	result.rigidMs = timeKind(rigidParents, rigidChildren, iterations, result.maxError);
+	result.uniformScaleMs = timeKind(uniformParents, uniformChildren, iterations, result.maxError);
+	result.generalMs = timeKind(generalParents, generalChildren, iterations, result.maxError);
+	return result;
+}
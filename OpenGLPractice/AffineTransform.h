@@ -0,0 +1,228 @@
+#ifndef AFFINE_TRANSFORM_H
+#define AFFINE_TRANSFORM_H
+
+#include "glm\glm\glm.hpp"
+#include "glm\glm\gtc\quaternion.hpp"
+
+// transforms that know at compile time which parts of a full matrix they can have, so composing and inverting only does
+// the math that kind needs. a translation composes with three adds where a mat4 multiply is 64 multiplies, and a rigid
+// transform inverts with a conjugate instead of a general 4x4 inverse. composing two kinds gives the more general one.
+// everything here is plain arithmetic on the components so it also works in constant expressions,
+// they only become a glm::mat4 through toMat4() when the matrix is uploaded
+enum class AffineKind {
+	Translation,
+	// rotation and translation
+	Rigid,
+	// rotation, one scale for every axis and translation
+	UniformScale,
+	// any 3x3 and translation, the top three rows of a mat4
+	General
+};
+
+template <AffineKind K>
+struct Affine;
+
+typedef Affine<AffineKind::Translation> TranslationTransform;
+typedef Affine<AffineKind::Rigid> RigidTransform;
+typedef Affine<AffineKind::UniformScale> UniformScaleTransform;
+typedef Affine<AffineKind::General> GeneralTransform;
+
+namespace AffineMath {
+	constexpr glm::vec3 add(const glm::vec3& a, const glm::vec3& b) {
+		return glm::vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+	constexpr glm::vec3 scale(const glm::vec3& v, float s) {
+		return glm::vec3(v.x * s, v.y * s, v.z * s);
+	}
+	constexpr glm::vec3 negate(const glm::vec3& v) {
+		return glm::vec3(-v.x, -v.y, -v.z);
+	}
+	constexpr float dot(const glm::vec3& a, const glm::vec3& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	constexpr glm::vec3 cross(const glm::vec3& a, const glm::vec3& b) {
+		return glm::vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	constexpr glm::quat multiply(const glm::quat& a, const glm::quat& b) {
+		return glm::quat(a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+			a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+			a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+			a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w);
+	}
+	// the inverse of a unit quaternion
+	constexpr glm::quat conjugate(const glm::quat& q) {
+		return glm::quat(q.w, -q.x, -q.y, -q.z);
+	}
+	// q * v * conjugate(q) for a unit quaternion, 15 multiplies instead of building a matrix
+	constexpr glm::vec3 rotate(const glm::quat& q, const glm::vec3& v) {
+		glm::vec3 axis(q.x, q.y, q.z);
+		glm::vec3 t = AffineMath::scale(AffineMath::cross(axis, v), 2.0f);
+		return AffineMath::add(AffineMath::add(v, AffineMath::scale(t, q.w)), AffineMath::cross(axis, t));
+	}
+	// column c of the rotation matrix of a unit quaternion
+	constexpr glm::vec3 rotationColumn(const glm::quat& q, int c) {
+		return c == 0 ? glm::vec3(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y))
+			: c == 1 ? glm::vec3(2.0f * (q.x * q.y - q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x))
+			: glm::vec3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+	}
+}
+
+template <>
+struct Affine<AffineKind::Translation> {
+	glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	constexpr Affine() {}
+	constexpr explicit Affine(const glm::vec3& translation) : translation(translation) {}
+
+	constexpr glm::vec3 transformPoint(const glm::vec3& p) const { return AffineMath::add(p, translation); }
+	constexpr glm::vec3 transformVector(const glm::vec3& v) const { return v; }
+	constexpr Affine inverse() const { return Affine(AffineMath::negate(translation)); }
+
+	static constexpr Affine compose(const Affine& a, const Affine& b) { return Affine(AffineMath::add(a.translation, b.translation)); }
+
+	glm::mat4 toMat4() const {
+		glm::mat4 m(1.0f);
+		m[3] = glm::vec4(translation, 1.0f);
+		return m;
+	}
+};
+
+template <>
+struct Affine<AffineKind::Rigid> {
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	constexpr Affine() {}
+	constexpr Affine(const glm::quat& rotation, const glm::vec3& translation) : rotation(rotation), translation(translation) {}
+	constexpr Affine(const TranslationTransform& t) : translation(t.translation) {}
+
+	constexpr glm::vec3 transformPoint(const glm::vec3& p) const { return AffineMath::add(AffineMath::rotate(rotation, p), translation); }
+	constexpr glm::vec3 transformVector(const glm::vec3& v) const { return AffineMath::rotate(rotation, v); }
+	constexpr Affine inverse() const {
+		return Affine(AffineMath::conjugate(rotation), AffineMath::negate(AffineMath::rotate(AffineMath::conjugate(rotation), translation)));
+	}
+
+	static constexpr Affine compose(const Affine& a, const Affine& b) {
+		return Affine(AffineMath::multiply(a.rotation, b.rotation), a.transformPoint(b.translation));
+	}
+	static constexpr Affine compose(const Affine& a, const TranslationTransform& b) { return Affine(a.rotation, a.transformPoint(b.translation)); }
+	static constexpr Affine compose(const TranslationTransform& a, const Affine& b) { return Affine(b.rotation, AffineMath::add(a.translation, b.translation)); }
+
+	glm::mat4 toMat4() const {
+		return glm::mat4(glm::vec4(AffineMath::rotationColumn(rotation, 0), 0.0f), glm::vec4(AffineMath::rotationColumn(rotation, 1), 0.0f),
+			glm::vec4(AffineMath::rotationColumn(rotation, 2), 0.0f), glm::vec4(translation, 1.0f));
+	}
+};
+
+template <>
+struct Affine<AffineKind::UniformScale> {
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
+	float scale = 1.0f;
+
+	constexpr Affine() {}
+	constexpr Affine(const glm::quat& rotation, const glm::vec3& translation, float scale) : rotation(rotation), translation(translation), scale(scale) {}
+	constexpr Affine(const TranslationTransform& t) : translation(t.translation) {}
+	constexpr Affine(const RigidTransform& r) : rotation(r.rotation), translation(r.translation) {}
+
+	constexpr glm::vec3 transformPoint(const glm::vec3& p) const { return AffineMath::add(transformVector(p), translation); }
+	constexpr glm::vec3 transformVector(const glm::vec3& v) const { return AffineMath::scale(AffineMath::rotate(rotation, v), scale); }
+	constexpr Affine inverse() const {
+		return Affine(AffineMath::conjugate(rotation),
+			AffineMath::negate(AffineMath::scale(AffineMath::rotate(AffineMath::conjugate(rotation), translation), 1.0f / scale)), 1.0f / scale);
+	}
+
+	static constexpr Affine compose(const Affine& a, const Affine& b) {
+		return Affine(AffineMath::multiply(a.rotation, b.rotation), a.transformPoint(b.translation), a.scale * b.scale);
+	}
+	static constexpr Affine compose(const Affine& a, const TranslationTransform& b) { return Affine(a.rotation, a.transformPoint(b.translation), a.scale); }
+	static constexpr Affine compose(const TranslationTransform& a, const Affine& b) { return Affine(b.rotation, AffineMath::add(a.translation, b.translation), b.scale); }
+
+	glm::mat4 toMat4() const {
+		return glm::mat4(glm::vec4(AffineMath::scale(AffineMath::rotationColumn(rotation, 0), scale), 0.0f),
+			glm::vec4(AffineMath::scale(AffineMath::rotationColumn(rotation, 1), scale), 0.0f),
+			glm::vec4(AffineMath::scale(AffineMath::rotationColumn(rotation, 2), scale), 0.0f), glm::vec4(translation, 1.0f));
+	}
+};
+
+template <>
+struct Affine<AffineKind::General> {
+	// the columns of the 3x3 part
+	glm::vec3 x = glm::vec3(1.0f, 0.0f, 0.0f);
+	glm::vec3 y = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 z = glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	constexpr Affine() {}
+	constexpr Affine(const glm::vec3& x, const glm::vec3& y, const glm::vec3& z, const glm::vec3& translation) : x(x), y(y), z(z), translation(translation) {}
+	constexpr Affine(const TranslationTransform& t) : translation(t.translation) {}
+	constexpr Affine(const RigidTransform& r)
+		: x(AffineMath::rotationColumn(r.rotation, 0)), y(AffineMath::rotationColumn(r.rotation, 1)), z(AffineMath::rotationColumn(r.rotation, 2)), translation(r.translation) {}
+	constexpr Affine(const UniformScaleTransform& u)
+		: x(AffineMath::scale(AffineMath::rotationColumn(u.rotation, 0), u.scale)), y(AffineMath::scale(AffineMath::rotationColumn(u.rotation, 1), u.scale)),
+		z(AffineMath::scale(AffineMath::rotationColumn(u.rotation, 2), u.scale)), translation(u.translation) {}
+
+	// translate * rotate * scale, what TransformStore::model() builds
+	static constexpr Affine fromTRS(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		return Affine(AffineMath::scale(AffineMath::rotationColumn(rotation, 0), scale.x), AffineMath::scale(AffineMath::rotationColumn(rotation, 1), scale.y),
+			AffineMath::scale(AffineMath::rotationColumn(rotation, 2), scale.z), position);
+	}
+
+	// the top three rows of a matrix whose bottom row is 0 0 0 1
+	static Affine fromMat4(const glm::mat4& m) { return Affine(glm::vec3(m[0]), glm::vec3(m[1]), glm::vec3(m[2]), glm::vec3(m[3])); }
+
+	constexpr glm::vec3 transformPoint(const glm::vec3& p) const { return AffineMath::add(transformVector(p), translation); }
+	constexpr glm::vec3 transformVector(const glm::vec3& v) const {
+		return AffineMath::add(AffineMath::add(AffineMath::scale(x, v.x), AffineMath::scale(y, v.y)), AffineMath::scale(z, v.z));
+	}
+	constexpr float determinant() const { return AffineMath::dot(x, AffineMath::cross(y, z)); }
+	// the rows of the inverse 3x3 are the cross products of the columns over the determinant. a singular transform gives infinities
+	constexpr Affine inverse() const { return inverseScaled(1.0f / determinant()); }
+
+	static constexpr Affine compose(const Affine& a, const Affine& b) {
+		return Affine(a.transformVector(b.x), a.transformVector(b.y), a.transformVector(b.z), a.transformPoint(b.translation));
+	}
+	static constexpr Affine compose(const Affine& a, const TranslationTransform& b) { return Affine(a.x, a.y, a.z, a.transformPoint(b.translation)); }
+	static constexpr Affine compose(const TranslationTransform& a, const Affine& b) { return Affine(b.x, b.y, b.z, AffineMath::add(a.translation, b.translation)); }
+
+	glm::mat4 toMat4() const {
+		return glm::mat4(glm::vec4(x, 0.0f), glm::vec4(y, 0.0f), glm::vec4(z, 0.0f), glm::vec4(translation, 1.0f));
+	}
+
+private:
+	constexpr Affine inverseScaled(float inverseDeterminant) const {
+		return inverseFromRows(AffineMath::scale(AffineMath::cross(y, z), inverseDeterminant),
+			AffineMath::scale(AffineMath::cross(z, x), inverseDeterminant), AffineMath::scale(AffineMath::cross(x, y), inverseDeterminant));
+	}
+	constexpr Affine inverseFromRows(const glm::vec3& r0, const glm::vec3& r1, const glm::vec3& r2) const {
+		return Affine(glm::vec3(r0.x, r1.x, r2.x), glm::vec3(r0.y, r1.y, r2.y), glm::vec3(r0.z, r1.z, r2.z),
+			glm::vec3(-AffineMath::dot(r0, translation), -AffineMath::dot(r1, translation), -AffineMath::dot(r2, translation)));
+	}
+};
+
+// a * b applies b first, like matrices. the result is the more general of the two kinds
+template <AffineKind A, AffineKind B>
+constexpr Affine<(A > B ? A : B)> operator*(const Affine<A>& a, const Affine<B>& b) {
+	return Affine<(A > B ? A : B)>::compose(a, b);
+}
+
+struct AffineBenchmarkResult {
+	unsigned int transformCount;
+	// a parent times a child and the inverse of the result, for every pair
+	double mat4Ms;
+	double translationMs;
+	double rigidMs;
+	double uniformScaleMs;
+	double generalMs;
+	// largest difference of any matrix element between each kind and the same math done with glm::mat4
+	float maxError;
+};
+
+namespace AffineTransformBenchmark {
+	// transformCount parent and child pairs of each kind, composed and inverted once per iteration. the mat4 time is the same
+	// on the general pairs turned into matrices, which is what every kind costs when the kind is not known
+	AffineBenchmarkResult run(unsigned int transformCount, unsigned int iterations);
+}
+
+#endif
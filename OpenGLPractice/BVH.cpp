@@ -0,0 +1,416 @@
+#include "BVH.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+namespace {
+	float surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+		glm::vec3 extent = max - min;
+		if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+			return 0.0f;
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	// 0 outside, 1 intersecting, 2 inside
+	int classify(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max) {
+		int result = 2;
+		for (const glm::vec4& plane : frustum.planes) {
+			glm::vec3 positive(plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y, plane.z > 0.0f ? max.z : min.z);
+			glm::vec3 negative(plane.x > 0.0f ? min.x : max.x, plane.y > 0.0f ? min.y : max.y, plane.z > 0.0f ? min.z : max.z);
+			glm::vec3 normal(plane);
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+				return 0;
+			if (glm::dot(normal, negative) + plane.w < 0.0f)
+				result = 1;
+		}
+		return result;
+	}
+
+	// slab test, returns the entry distance or FLT_MAX on a miss
+	float intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& min, const glm::vec3& max) {
+		float tx1 = (min.x - origin.x) * inverseDirection.x, tx2 = (max.x - origin.x) * inverseDirection.x;
+		float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
+		float ty1 = (min.y - origin.y) * inverseDirection.y, ty2 = (max.y - origin.y) * inverseDirection.y;
+		tmin = std::max(tmin, std::min(ty1, ty2)); tmax = std::min(tmax, std::max(ty1, ty2));
+		float tz1 = (min.z - origin.z) * inverseDirection.z, tz2 = (max.z - origin.z) * inverseDirection.z;
+		tmin = std::max(tmin, std::min(tz1, tz2)); tmax = std::min(tmax, std::max(tz1, tz2));
+		if (tmax >= tmin && tmax >= 0.0f && tmin < maxDistance)
+			return std::max(tmin, 0.0f);
+		return FLT_MAX;
+	}
+}
+
+void BVH::build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs) {
+	objectMins = mins;
+	objectMaxs = maxs;
+	objectIndices.resize(objectMins.size());
+	for (unsigned int i = 0; i < objectIndices.size(); i++)
+		objectIndices[i] = i;
+	rebuild();
+}
+
+void BVH::rebuild() {
+	unsigned int count = objectCount();
+	nodes.clear();
+	dirtyLeaves.clear();
+	if (count == 0) {
+		cost = buildCost = 0.0f;
+		return;
+	}
+
+	centroids.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		centroids[i] = (objectMins[i] + objectMaxs[i]) * 0.5f;
+
+	nodes.reserve(2 * count);
+	parents.assign(1, 0);
+	nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), count });
+	fitLeaf(nodes[0]);
+	subdivide(0);
+
+	objectLeaf.resize(count);
+	for (unsigned int n = 0; n < nodes.size(); n++) {
+		const BVHNode& node = nodes[n];
+		for (unsigned int i = 0; i < node.count; i++)
+			objectLeaf[objectIndices[node.leftOrFirst + i]] = n;
+	}
+
+	cost = buildCost = computeCost();
+}
+
+void BVH::fitLeaf(BVHNode& node) const {
+	node.min = glm::vec3(FLT_MAX);
+	node.max = glm::vec3(-FLT_MAX);
+	for (unsigned int i = 0; i < node.count; i++) {
+		unsigned int object = objectIndices[node.leftOrFirst + i];
+		node.min = glm::min(node.min, objectMins[object]);
+		node.max = glm::max(node.max, objectMaxs[object]);
+	}
+}
+
+// splits at the cheapest of SAH_BINS - 1 planes per axis over the centroid bounds, stops when no split beats a leaf
+void BVH::subdivide(unsigned int nodeIndex) {
+	BVHNode node = nodes[nodeIndex];
+	if (node.count <= MAX_LEAF_SIZE)
+		return;
+
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (unsigned int i = 0; i < node.count; i++) {
+		const glm::vec3& c = centroids[objectIndices[node.leftOrFirst + i]];
+		centroidMin = glm::min(centroidMin, c);
+		centroidMax = glm::max(centroidMax, c);
+	}
+
+	int bestAxis = -1;
+	unsigned int bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		struct Bin { glm::vec3 min = glm::vec3(FLT_MAX), max = glm::vec3(-FLT_MAX); unsigned int count = 0; };
+		Bin bins[SAH_BINS];
+		float scale = SAH_BINS / extent;
+
+		for (unsigned int i = 0; i < node.count; i++) {
+			unsigned int object = objectIndices[node.leftOrFirst + i];
+			unsigned int b = std::min(SAH_BINS - 1, (unsigned int)((centroids[object][axis] - centroidMin[axis]) * scale));
+			bins[b].count++;
+			bins[b].min = glm::min(bins[b].min, objectMins[object]);
+			bins[b].max = glm::max(bins[b].max, objectMaxs[object]);
+		}
+
+		// sweeps from both ends to get the area and count on each side of every plane
+		float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+		unsigned int leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+		glm::vec3 leftMin(FLT_MAX), leftMax(-FLT_MAX), rightMin(FLT_MAX), rightMax(-FLT_MAX);
+		unsigned int leftSum = 0, rightSum = 0;
+		for (unsigned int b = 0; b < SAH_BINS - 1; b++) {
+			leftSum += bins[b].count;
+			leftMin = glm::min(leftMin, bins[b].min);
+			leftMax = glm::max(leftMax, bins[b].max);
+			leftCount[b] = leftSum;
+			leftArea[b] = surfaceArea(leftMin, leftMax);
+
+			unsigned int r = SAH_BINS - 1 - b;
+			rightSum += bins[r].count;
+			rightMin = glm::min(rightMin, bins[r].min);
+			rightMax = glm::max(rightMax, bins[r].max);
+			rightCount[r - 1] = rightSum;
+			rightArea[r - 1] = surfaceArea(rightMin, rightMax);
+		}
+
+		for (unsigned int split = 0; split < SAH_BINS - 1; split++) {
+			if (leftCount[split] == 0 || rightCount[split] == 0)
+				continue;
+			float splitCost = leftCount[split] * leftArea[split] + rightCount[split] * rightArea[split];
+			if (splitCost < bestCost) {
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	float leafCost = node.count * surfaceArea(node.min, node.max);
+	if (bestAxis < 0 || bestCost >= leafCost)
+		return;
+
+	float scale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	auto first = objectIndices.begin() + node.leftOrFirst;
+	auto middle = std::partition(first, first + node.count, [&](unsigned int object) {
+		unsigned int b = std::min(SAH_BINS - 1, (unsigned int)((centroids[object][bestAxis] - centroidMin[bestAxis]) * scale));
+		return b <= bestSplit;
+	});
+	unsigned int leftCount = (unsigned int)(middle - first);
+
+	unsigned int left = (unsigned int)nodes.size();
+	nodes.push_back({ glm::vec3(0.0f), node.leftOrFirst, glm::vec3(0.0f), leftCount });
+	nodes.push_back({ glm::vec3(0.0f), node.leftOrFirst + leftCount, glm::vec3(0.0f), node.count - leftCount });
+	parents.push_back(nodeIndex);
+	parents.push_back(nodeIndex);
+	fitLeaf(nodes[left]);
+	fitLeaf(nodes[left + 1]);
+
+	nodes[nodeIndex].leftOrFirst = left;
+	nodes[nodeIndex].count = 0;
+
+	subdivide(left);
+	subdivide(left + 1);
+}
+
+// expected cost of a random query relative to the root: sum of node areas over root area, leaves weighted by object count
+float BVH::computeCost() const {
+	float rootArea = surfaceArea(nodes[0].min, nodes[0].max);
+	if (rootArea <= 0.0f)
+		return 0.0f;
+
+	float total = 0.0f;
+	for (const BVHNode& node : nodes)
+		total += surfaceArea(node.min, node.max) * (node.count > 0 ? (float)node.count : 1.0f);
+	return total / rootArea;
+}
+
+void BVH::updateObject(unsigned int object, const glm::vec3& min, const glm::vec3& max) {
+	objectMins[object] = min;
+	objectMaxs[object] = max;
+	dirtyLeaves.push_back(objectLeaf[object]);
+}
+
+// refits every dirty leaf and walks up while the parent box actually changes
+void BVH::refit() {
+	if (dirtyLeaves.empty())
+		return;
+
+	for (unsigned int leaf : dirtyLeaves) {
+		fitLeaf(nodes[leaf]);
+
+		unsigned int n = leaf;
+		while (n != 0) {
+			n = parents[n];
+			BVHNode& node = nodes[n];
+			const BVHNode& left = nodes[node.leftOrFirst];
+			const BVHNode& right = nodes[node.leftOrFirst + 1];
+			glm::vec3 min = glm::min(left.min, right.min);
+			glm::vec3 max = glm::max(left.max, right.max);
+			if (min == node.min && max == node.max)
+				break;
+			node.min = min;
+			node.max = max;
+		}
+	}
+	dirtyLeaves.clear();
+	cost = computeCost();
+}
+
+bool BVH::refitAndMaybeRebuild() {
+	refit();
+	if (!needsRebuild())
+		return false;
+	rebuild();
+	return true;
+}
+
+void BVH::collect(unsigned int nodeIndex, std::vector<unsigned int>& objects) const {
+	const BVHNode& node = nodes[nodeIndex];
+	if (node.count > 0) {
+		objects.insert(objects.end(), objectIndices.begin() + node.leftOrFirst, objectIndices.begin() + node.leftOrFirst + node.count);
+		return;
+	}
+	collect(node.leftOrFirst, objects);
+	collect(node.leftOrFirst + 1, objects);
+}
+
+void BVH::frustumQuery(const Frustum& frustum, std::vector<unsigned int>& objects) const {
+	if (nodes.empty())
+		return;
+
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		unsigned int nodeIndex = stack.back();
+		stack.pop_back();
+		const BVHNode& node = nodes[nodeIndex];
+
+		int side = classify(frustum, node.min, node.max);
+		if (side == 0)
+			continue;
+		// fully inside, everything below is visible without further tests
+		if (side == 2) {
+			collect(nodeIndex, objects);
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (unsigned int i = 0; i < node.count; i++) {
+				unsigned int object = objectIndices[node.leftOrFirst + i];
+				if (classify(frustum, objectMins[object], objectMaxs[object]) != 0)
+					objects.push_back(object);
+			}
+		}
+		else {
+			stack.push_back(node.leftOrFirst);
+			stack.push_back(node.leftOrFirst + 1);
+		}
+	}
+}
+
+BVHRayHit BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+	BVHRayHit hit = { -1, maxDistance };
+	if (nodes.empty())
+		return hit;
+
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+		if (intersect(origin, inverseDirection, hit.distance, node.min, node.max) == FLT_MAX)
+			continue;
+
+		if (node.count > 0) {
+			for (unsigned int i = 0; i < node.count; i++) {
+				unsigned int object = objectIndices[node.leftOrFirst + i];
+				float t = intersect(origin, inverseDirection, hit.distance, objectMins[object], objectMaxs[object]);
+				if (t < hit.distance) {
+					hit.distance = t;
+					hit.object = (int)object;
+				}
+			}
+			continue;
+		}
+
+		// visits the nearer child first so its hit shortens the ray for the other
+		unsigned int nearChild = node.leftOrFirst, farChild = node.leftOrFirst + 1;
+		float nearT = intersect(origin, inverseDirection, hit.distance, nodes[nearChild].min, nodes[nearChild].max);
+		float farT = intersect(origin, inverseDirection, hit.distance, nodes[farChild].min, nodes[farChild].max);
+		if (farT < nearT) {
+			std::swap(nearChild, farChild);
+			std::swap(nearT, farT);
+		}
+		if (farT != FLT_MAX)
+			stack.push_back(farChild);
+		if (nearT != FLT_MAX)
+			stack.push_back(nearChild);
+	}
+	return hit;
+}
+
+BVHBenchmarkResult BVHBenchmark::run(unsigned int boxCount, unsigned int rayCount) {
+	std::mt19937 random(5);
+	std::vector<glm::vec3> mins, maxs;
+	for (unsigned int i = 0; i < boxCount; i++) {
+		glm::vec3 min = Benchmark::randomVec3(random, -200.0f, 200.0f);
+		mins.push_back(min);
+		maxs.push_back(min + Benchmark::randomVec3(random, 0.5f, 4.0f));
+	}
+
+	std::vector<glm::vec3> origins, directions;
+	for (unsigned int i = 0; i < rayCount; i++) {
+		origins.push_back(Benchmark::randomVec3(random, -200.0f, 200.0f));
+		directions.push_back(Benchmark::randomAxis(random));
+	}
+	const float MAX_DISTANCE = 1000.0f;
+
+	BVHBenchmarkResult result;
+	result.boxCount = boxCount;
+	result.rayCount = rayCount;
+
+	BVH bvh;
+	result.buildMs = Benchmark::averageMs(1, [&]() { bvh.build(mins, maxs); });
+
+	std::vector<BVHRayHit> bvhHits(rayCount), bruteForceHits(rayCount);
+	auto castBVH = [&]() {
+		for (unsigned int r = 0; r < rayCount; r++)
+			bvhHits[r] = bvh.raycast(origins[r], directions[r], MAX_DISTANCE);
+	};
+	auto castBruteForce = [&]() {
+		for (unsigned int r = 0; r < rayCount; r++) {
+			const glm::vec3& d = directions[r];
+			glm::vec3 inverseDirection(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+			BVHRayHit hit = { -1, MAX_DISTANCE };
+			for (unsigned int i = 0; i < boxCount; i++) {
+				float t = intersect(origins[r], inverseDirection, hit.distance, mins[i], maxs[i]);
+				if (t < hit.distance) {
+					hit.distance = t;
+					hit.object = (int)i;
+				}
+			}
+			bruteForceHits[r] = hit;
+		}
+	};
+	// boxes overlap, so two can be entered at the same distance and either one is right
+	auto resultsMatch = [&]() {
+		for (unsigned int r = 0; r < rayCount; r++) {
+			if ((bvhHits[r].object >= 0) != (bruteForceHits[r].object >= 0) || bvhHits[r].distance != bruteForceHits[r].distance)
+				return false;
+		}
+		return true;
+	};
+
+	result.bvhRaysMs = Benchmark::averageMs(1, castBVH);
+	result.bruteForceRaysMs = Benchmark::averageMs(1, castBruteForce);
+	result.hits = 0;
+	for (unsigned int r = 0; r < rayCount; r++) {
+		if (bvhHits[r].object >= 0)
+			result.hits++;
+	}
+	result.resultsMatch = resultsMatch();
+
+	// every round a tenth of the boxes jumps up to 16 units, so the leaves stretch and overlap more as the rounds go on
+	result.moveRounds = 20;
+	result.movedPerRound = boxCount / 10;
+	result.rebuilds = 0;
+	result.movedResultsMatch = true;
+	std::uniform_int_distribution<unsigned int> pick(0, boxCount - 1);
+	double refitTotal = 0.0;
+	for (unsigned int round = 0; round < result.moveRounds; round++) {
+		for (unsigned int m = 0; m < result.movedPerRound; m++) {
+			unsigned int i = pick(random);
+			glm::vec3 offset = Benchmark::randomVec3(random, -16.0f, 16.0f);
+			mins[i] += offset;
+			maxs[i] += offset;
+			bvh.updateObject(i, mins[i], maxs[i]);
+		}
+		refitTotal += Benchmark::averageMs(1, [&]() {
+			if (bvh.refitAndMaybeRebuild())
+				result.rebuilds++;
+		});
+
+		castBVH();
+		castBruteForce();
+		result.movedResultsMatch = result.movedResultsMatch && resultsMatch();
+	}
+	result.refitMs = refitTotal / result.moveRounds;
+	return result;
+}
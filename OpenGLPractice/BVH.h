@@ -0,0 +1,101 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "FrustumCulling.h"
+
+// 32 bytes, two per cache line. a leaf has count > 0 and covers objectIndices[first, first + count),
+// an inner node has count == 0 and its children sit next to each other at left and left + 1
+struct BVHNode {
+	glm::vec3 min;
+	unsigned int leftOrFirst;
+	glm::vec3 max;
+	unsigned int count;
+};
+
+struct BVHRayHit {
+	int object;     // -1 when nothing was hit
+	float distance;
+};
+
+// bounding volume hierarchy over object bounding boxes, built top down with a binned surface area heuristic
+// into one flat node array. moving objects are handled by refitting the boxes on the path from their leaf to the root;
+// once refits have degraded the tree too far compared to its build, needsRebuild() says so
+class BVH
+{
+public:
+	static const unsigned int MAX_LEAF_SIZE = 4;
+	static const unsigned int SAH_BINS = 12;
+
+	// takes over the boxes, object i is the box at index i
+	void build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs);
+	// rebuilds from the current object boxes, keeping the object indices
+	void rebuild();
+
+	// records the new box of a moved object, refit() applies all of them
+	void updateObject(unsigned int object, const glm::vec3& min, const glm::vec3& max);
+	void refit();
+	// true when the SAH cost of the refitted tree is more than rebuildThreshold times its cost right after the build
+	bool needsRebuild() const { return cost > buildCost * rebuildThreshold; }
+	// refits the moved objects and rebuilds if that left the tree too slow, returns true when it rebuilt
+	bool refitAndMaybeRebuild();
+	void setRebuildThreshold(float threshold) { rebuildThreshold = threshold; }
+
+	// appends every object whose box is inside or intersects the frustum
+	void frustumQuery(const Frustum& frustum, std::vector<unsigned int>& objects) const;
+	// nearest object box hit by the ray within maxDistance. direction does not have to be normalized,
+	// distance is in units of its length
+	BVHRayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	unsigned int objectCount() const { return (unsigned int)objectMins.size(); }
+	const std::vector<BVHNode>& getNodes() const { return nodes; }
+	float sahCost() const { return cost; }
+
+private:
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> objectIndices;
+	std::vector<glm::vec3> objectMins, objectMaxs;
+	std::vector<glm::vec3> centroids;
+
+	// for refits: parent of every node and the leaf holding every object
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> objectLeaf;
+	std::vector<unsigned int> dirtyLeaves;
+
+	float buildCost = 0.0f;
+	float cost = 0.0f;
+	float rebuildThreshold = 1.5f;
+
+	void fitLeaf(BVHNode& node) const;
+	void subdivide(unsigned int nodeIndex);
+	float computeCost() const;
+	void collect(unsigned int nodeIndex, std::vector<unsigned int>& objects) const;
+};
+
+struct BVHBenchmarkResult {
+	unsigned int boxCount;
+	unsigned int rayCount;
+	double buildMs;
+	double bvhRaysMs;
+	double bruteForceRaysMs;
+	unsigned int hits;
+	// every ray found its nearest box at the same distance as testing every box did
+	bool resultsMatch;
+
+	// afterwards a part of the boxes drifts every round and the tree is refitted, or rebuilt once it has degraded
+	unsigned int moveRounds;
+	unsigned int movedPerRound;
+	double refitMs;
+	unsigned int rebuilds;
+	// the same rays still match testing every box after each round
+	bool movedResultsMatch;
+};
+
+namespace BVHBenchmark {
+	// random boxes from a fixed seed and random rays cast from inside their volume, every ray once through the BVH
+	// and once against every box. then moves boxes for a number of rounds and checks the refitted tree the same way
+	BVHBenchmarkResult run(unsigned int boxCount, unsigned int rayCount);
+}
+
+#endif
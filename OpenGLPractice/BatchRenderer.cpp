@@ -0,0 +1,207 @@
+#include "BatchRenderer.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+BatchRenderer::BatchRenderer(unsigned int VAO) : VAO(VAO), instanceCapacity(0), commandCapacity(0), upload(GL_COPY_READ_BUFFER, UPLOAD_SIZE),
+	indirect(GLAD_GL_VERSION_4_3 != 0), dirty(true), sorted(false), drawCalls(0)
+{
+	glGenBuffers(1, &instanceVBO);
+
+	// attaches the instance buffer to the shared VAO, one vec4 column of the model matrix per attribute
+	glState.bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int column = 0; column < 4; column++) {
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(2 + column);
+		glVertexAttribDivisor(2 + column, 1);
+	}
+	glState.bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	indirectBuffer = 0;
+	if (indirect)
+		glGenBuffers(1, &indirectBuffer);
+
+	noTextures = queue.addTextureSet({});
+}
+
+unsigned int BatchRenderer::addMaterial(Shader* shader, const std::vector<unsigned int>& textures) {
+	materials.push_back({ shader, queue.addTextureSet(textures) });
+	batches.push_back({ 0, 0 });
+	return (unsigned int)materials.size() - 1;
+}
+
+void BatchRenderer::submit(unsigned int material, GLint first, GLsizei count, const glm::mat4& model) {
+	requests.push_back({ material, first, count, model });
+	dirty = true;
+	sorted = false;
+}
+
+void BatchRenderer::clear() {
+	requests.clear();
+	dirty = true;
+	sorted = false;
+}
+
+// sorts in the order build() groups the draws in, by material and mesh and then by distance, so build() moves nothing
+// and the requests only count as reordered when the camera moved far enough to swap two draws of the same mesh
+void BatchRenderer::sortFrontToBack(const glm::vec3& cameraPos) {
+	if (sorted && cameraPos == sortedFrom)
+		return;
+
+	auto distance = [&cameraPos](const DrawRequest& request) {
+		glm::vec3 offset = glm::vec3(request.model[3]) - cameraPos;
+		return glm::dot(offset, offset);
+	};
+	auto nearer = [&distance](const DrawRequest& a, const DrawRequest& b) {
+		if (a.material != b.material)
+			return a.material < b.material;
+		if (a.first != b.first)
+			return a.first < b.first;
+		if (a.count != b.count)
+			return a.count < b.count;
+		return distance(a) < distance(b);
+	};
+
+	sorted = true;
+	sortedFrom = cameraPos;
+	if (std::is_sorted(requests.begin(), requests.end(), nearer))
+		return;
+
+	std::stable_sort(requests.begin(), requests.end(), nearer);
+	dirty = true;
+}
+
+// sorts the draws by material and mesh so every material owns a contiguous run of commands,
+// and every distinct mesh inside it becomes a single command whose instances are contiguous in the instance buffer
+void BatchRenderer::build() {
+	std::stable_sort(requests.begin(), requests.end(), [](const DrawRequest& a, const DrawRequest& b) {
+		if (a.material != b.material)
+			return a.material < b.material;
+		if (a.first != b.first)
+			return a.first < b.first;
+		return a.count < b.count;
+	});
+
+	std::vector<glm::mat4> instances;
+	instances.reserve(requests.size());
+	commands.clear();
+	for (MaterialBatch& batch : batches)
+		batch = { 0, 0 };
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		const DrawRequest& request = requests[i];
+		MaterialBatch& batch = batches[request.material];
+
+		bool sameMesh = batch.commandCount > 0 &&
+			commands.back().firstIndex == (GLuint)request.first && commands.back().count == (GLuint)request.count;
+
+		if (sameMesh) {
+			commands.back().instanceCount++;
+		}
+		else {
+			if (batch.commandCount == 0)
+				batch.firstCommand = (unsigned int)commands.size();
+			commands.push_back({ (GLuint)request.count, 1, (GLuint)request.first, 0, (GLuint)instances.size() });
+			batch.commandCount++;
+		}
+		instances.push_back(request.model);
+	}
+
+	// one stream buffer frame per rebuild. everything is staged first, the region is unmapped once before the copies read it
+	size_t instanceBytes = instances.size() * sizeof(glm::mat4);
+	size_t commandBytes = indirect ? commands.size() * sizeof(DrawElementsIndirectCommand) : 0;
+	upload.beginFrame();
+	StreamBuffer::Allocation instanceData = upload.allocate(instanceBytes);
+	if (instanceData.data != NULL && instanceBytes > 0)
+		std::memcpy(instanceData.data, instances.data(), instanceBytes);
+	StreamBuffer::Allocation commandData = upload.allocate(commandBytes);
+	if (commandData.data != NULL && commandBytes > 0)
+		std::memcpy(commandData.data, commands.data(), commandBytes);
+	upload.commit();
+
+	copyTo(GL_ARRAY_BUFFER, instanceVBO, instanceCapacity, instanceData, instances.data(), instanceBytes);
+	if (indirect)
+		copyTo(GL_DRAW_INDIRECT_BUFFER, indirectBuffer, commandCapacity, commandData, commands.data(), commandBytes);
+	upload.endFrame();
+
+	dirty = false;
+}
+
+void BatchRenderer::copyTo(GLenum target, unsigned int buffer, size_t& capacity, const StreamBuffer::Allocation& staged, const void* data, size_t size) {
+	glBindBuffer(target, buffer);
+	if (size > capacity) {
+		capacity = std::max(size, capacity * 2);
+		glBufferData(target, capacity, NULL, GL_DYNAMIC_DRAW);
+	}
+
+	if (size > 0 && staged.data != NULL) {
+		glBindBuffer(GL_COPY_READ_BUFFER, upload.ID());
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, target, staged.offset, 0, size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	else if (size > 0) {
+		// did not fit into a region of the stream buffer
+		glBufferSubData(target, 0, size, data);
+	}
+	glBindBuffer(target, 0);
+}
+
+// 3.3 has no baseInstance, so the instance attributes are re-pointed at the first matrix of the command instead
+void BatchRenderer::setInstanceOffset(GLuint baseInstance) {
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int column = 0; column < 4; column++) {
+		size_t offset = baseInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4);
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)offset);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BatchRenderer::flush(Shader* override) {
+	if (dirty)
+		build();
+
+	// one item per material that has draws, all with the same depth so the queue keeps their order within equal state
+	queue.clear();
+	for (unsigned int m = 0; m < materials.size(); m++) {
+		if (batches[m].commandCount == 0)
+			continue;
+		unsigned int program = override ? override->ID : materials[m].shader->ID;
+		unsigned int textureSet = override ? noTextures : materials[m].textureSet;
+		queue.submit({ RenderQueue::makeKey(program, textureSet, VAO, 0.0f, 0.0f, 1.0f), program, textureSet, VAO, m });
+	}
+	queue.sort();
+
+	drawCalls = 0;
+	if (indirect)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+
+	queue.execute([this](const RenderItem& item) {
+		const MaterialBatch& batch = batches[item.userData];
+		if (indirect) {
+			const void* offset = (const void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand));
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, batch.commandCount, 0);
+			drawCalls++;
+		}
+		else {
+			for (unsigned int c = batch.firstCommand; c < batch.firstCommand + batch.commandCount; c++) {
+				const DrawElementsIndirectCommand& command = commands[c];
+				setInstanceOffset(command.baseInstance);
+				glDrawElementsInstanced(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(GLuint)), command.instanceCount);
+				drawCalls++;
+			}
+		}
+	});
+
+	if (indirect)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void BatchRenderer::discard() {
+	upload.discard();
+	glDeleteBuffers(1, &instanceVBO);
+	if (indirect)
+		glDeleteBuffers(1, &indirectBuffer);
+}
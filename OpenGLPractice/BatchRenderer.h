@@ -0,0 +1,98 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include "shader.h"
+#include "RenderQueue.h"
+#include "StreamBuffer.h"
+
+// layout of one command in the indirect buffer, as read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// a shader together with the textures it samples. the textures are a render queue texture set, bound to units 0..n in order
+struct BatchMaterial {
+	Shader* shader;
+	unsigned int textureSet;
+};
+
+// collects draws of meshes that live in one shared VAO, indexed with unsigned ints from its element buffer,
+// and submits them with one API call per material.
+// uses glMultiDrawElementsIndirect on 4.3 contexts and falls back to one instanced draw per mesh on 3.3.
+// the materials are submitted through a RenderQueue, so they are drawn grouped by program and then textures
+// and only the state that differs from the material before is bound.
+// the model matrix of every draw is fed to the vertex shader as an instanced mat4 at locations 2 to 5
+// rebuilt instance and command data is written into a StreamBuffer and copied on the gpu into the buffers the draws read,
+// so a rebuild never respecifies a buffer that earlier frames may still be drawing from
+class BatchRenderer
+{
+public:
+	BatchRenderer(unsigned int VAO);
+
+	unsigned int addMaterial(Shader* shader, const std::vector<unsigned int>& textures);
+
+	// queues one draw of the indices [first, first + count) of the shared VAO
+	void submit(unsigned int material, GLint first, GLsizei count, const glm::mat4& model);
+	// drops every queued draw, the next flush rebuilds the command and instance buffers
+	void clear();
+	// orders the draws inside every material and mesh front to back from the camera, nearest first.
+	// the buffers are only rebuilt on the next flush if that changed the order
+	void sortFrontToBack(const glm::vec3& cameraPos);
+	// draws everything queued so far. buffers are only rebuilt if draws were added, cleared or reordered since the last flush.
+	// when override is set it is used for every material instead of the material's shader and textures, e.g. for a depth pre-pass
+	void flush(Shader* override = nullptr);
+	void discard();
+
+	bool usesIndirect() const { return indirect; }
+	unsigned int drawCallsLastFlush() const { return drawCalls; }
+
+private:
+	struct DrawRequest {
+		unsigned int material;
+		GLint first;
+		GLsizei count;
+		glm::mat4 model;
+	};
+
+	struct MaterialBatch {
+		unsigned int firstCommand;
+		unsigned int commandCount;
+	};
+
+	static const size_t UPLOAD_SIZE = 1 << 20;
+
+	unsigned int VAO;
+	unsigned int instanceVBO;
+	unsigned int indirectBuffer;
+	size_t instanceCapacity;
+	size_t commandCapacity;
+	StreamBuffer upload;
+	bool indirect;
+	bool dirty;
+	bool sorted;
+	glm::vec3 sortedFrom;
+	unsigned int drawCalls;
+
+	RenderQueue queue;
+	// what the materials bind while an override shader is drawing
+	unsigned int noTextures;
+
+	std::vector<BatchMaterial> materials;
+	std::vector<DrawRequest> requests;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<MaterialBatch> batches;
+
+	void build();
+	// copies what was staged into buffer, growing it first if it is too small. data is written directly when staging failed
+	void copyTo(GLenum target, unsigned int buffer, size_t& capacity, const StreamBuffer::Allocation& staged, const void* data, size_t size);
+	void setInstanceOffset(GLuint baseInstance);
+};
+
+#endif
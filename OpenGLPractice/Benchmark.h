@@ -0,0 +1,42 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <random>
+#include "glm\glm\glm.hpp"
+#include "glm\glm\gtc\quaternion.hpp"
+
+// helpers shared by the measurements main.cpp prints with --bench
+namespace Benchmark {
+	// runs pass the given number of times, returns the average milliseconds per run
+	template <typename Pass>
+	double averageMs(unsigned int iterations, Pass pass) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int it = 0; it < iterations; it++)
+			pass();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+
+	inline glm::vec3 randomVec3(std::mt19937& random, float min, float max) {
+		std::uniform_real_distribution<float> component(min, max);
+		return glm::vec3(component(random), component(random), component(random));
+	}
+
+	// nudged off the origin before normalizing, three components can all come out as zero
+	inline glm::vec3 randomAxis(std::mt19937& random) {
+		return glm::normalize(randomVec3(random, -1.0f, 1.0f) + glm::vec3(0.0f, 0.01f, 0.0f));
+	}
+
+	// radians in [-pi, pi)
+	inline float randomAngle(std::mt19937& random) {
+		return std::uniform_real_distribution<float>(-1.0f, 1.0f)(random) * 3.14159265f;
+	}
+
+	inline glm::quat randomRotation(std::mt19937& random) {
+		glm::vec3 axis = randomAxis(random);
+		return glm::angleAxis(randomAngle(random), axis);
+	}
+}
+
+#endif
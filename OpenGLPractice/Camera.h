@@ -4,6 +4,8 @@
 #include "glad/glad.h"
 #include "glm\glm\glm.hpp"
 #include "glm\glm\gtc\matrix_transform.hpp"
+#include "glm\glm\gtc\quaternion.hpp"
+#include "FrustumCulling.h"
 
 #include <vector>
 
@@ -22,6 +24,8 @@ const float PITCH = 0.0f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
 const float SPEED = 5.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
 class Camera {
 public:
@@ -38,6 +42,9 @@ public:
 	float MovementSpeed;
 	float MouseSensitivity;
 	float Zoom;
+
+	//the matrices and frustum are cached and only rebuilt after something changed them. the attributes above should only
+	//be changed through the Process/Set functions, or followed by Invalidate(), otherwise the cache goes stale
 	
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
@@ -58,10 +65,46 @@ public:
     }
 
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix()
+    const glm::mat4& GetViewMatrix()
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        refresh();
+        return view;
+    }
+    const glm::mat4& GetProjectionMatrix() { refresh(); return projection; }
+    const glm::mat4& GetViewProjectionMatrix() { refresh(); return viewProj; }
+    const glm::mat4& GetInverseViewMatrix() { refresh(); return inverseView; }
+    const glm::mat4& GetInverseViewProjectionMatrix() { refresh(); return inverseViewProj; }
+    const Frustum& GetFrustum() { refresh(); return frustum; }
+
+    // goes up by one every time the matrices change, so users can skip work when it is the same as last time
+    unsigned int GetVersion() { refresh(); return version; }
+
+    // aspect ratio comes from the framebuffer, a zero size (minimized window) is ignored
+    void SetViewport(int width, int height) {
+        if (width <= 0 || height <= 0 || (width == ViewportWidth && height == ViewportHeight))
+            return;
+        ViewportWidth = width;
+        ViewportHeight = height;
+        dirty = true;
+    }
+    void SetPosition(const glm::vec3& position) {
+        if (position == Position)
+            return;
+        Position = position;
+        dirty = true;
     }
+    void SetClipPlanes(float nearPlane, float farPlane) {
+        NearPlane = nearPlane;
+        FarPlane = farPlane;
+        dirty = true;
+    }
+    int GetViewportWidth() const { return ViewportWidth; }
+    int GetViewportHeight() const { return ViewportHeight; }
+    float GetAspectRatio() const { return (float)ViewportWidth / (float)ViewportHeight; }
+    float GetNearPlane() const { return NearPlane; }
+    float GetFarPlane() const { return FarPlane; }
+
+    void Invalidate() { dirty = true; }
 
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
         float velocity = MovementSpeed * deltaTime;
@@ -76,13 +119,20 @@ public:
             Position += Right * velocity;
         if (direction == UP)
             Position += Up * velocity;
+        dirty = dirty || velocity != 0.0f;
 
         /*Position.y = 1.0f;*/
     }
+    // meant to be called once per frame with the summed cursor movement, see InputAccumulator
     void ProcessMouseMovement(float xOffset, float yOffset, GLboolean ConstrainPitch = true) {
+        if (xOffset == 0.0f && yOffset == 0.0f)
+            return;
+
         xOffset *= MouseSensitivity;
         yOffset *= MouseSensitivity;
 
+        float lastYaw = Yaw;
+        float lastPitch = Pitch;
         Yaw += xOffset;
         Pitch += yOffset;
 
@@ -93,18 +143,75 @@ public:
                 Pitch = -89.0;
         }
 
+        if (quaternionOrientation)
+            rotateOrientation(Yaw - lastYaw, Pitch - lastPitch);
+        else
+            updateCameraVectors();
+    }
+
+    // turns the camera by rotating a quaternion instead of rebuilding the vectors from yaw and pitch.
+    // Yaw and Pitch are still kept, so switching back and forth lands on the same view
+    void SetQuaternionOrientation(bool enabled) {
+        quaternionOrientation = enabled;
+        if (enabled)
+            orientation = glm::angleAxis(glm::radians(-(Yaw - YAW)), WorldUp) * glm::angleAxis(glm::radians(Pitch), glm::vec3(1.0f, 0.0f, 0.0f));
         updateCameraVectors();
     }
+    bool UsesQuaternionOrientation() const { return quaternionOrientation; }
     void ProcessMouseScroll(float yOffset) {
         Zoom -= (float)yOffset;
         if (Zoom < 1.0f)
             Zoom = 1.0f;
         if (Zoom > 45.0f)
             Zoom = 45.0f;
+        dirty = true;
     }
 
 private:
+    int ViewportWidth = 800;
+    int ViewportHeight = 600;
+    float NearPlane = NEAR_PLANE;
+    float FarPlane = FAR_PLANE;
+
+    bool quaternionOrientation = false;
+    glm::quat orientation;
+
+    bool dirty = true;
+    unsigned int version = 0;
+    glm::mat4 view, projection, viewProj;
+    glm::mat4 inverseView, inverseViewProj;
+    Frustum frustum;
+
+    void refresh() {
+        if (!dirty)
+            return;
+        view = glm::lookAt(Position, Position + Front, Up);
+        projection = glm::perspective(glm::radians(Zoom), GetAspectRatio(), NearPlane, FarPlane);
+        viewProj = projection * view;
+        inverseView = glm::inverse(view);
+        inverseViewProj = glm::inverse(viewProj);
+        frustum = FrustumCulling::extract(viewProj);
+        version++;
+        dirty = false;
+    }
+
+    // yaw turns around the world up, pitch around the camera's own right, so the camera never rolls
+    void rotateOrientation(float yawDegrees, float pitchDegrees) {
+        orientation = glm::angleAxis(glm::radians(-yawDegrees), WorldUp) * orientation * glm::angleAxis(glm::radians(pitchDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+        orientation = glm::normalize(orientation);
+
+        Front = orientation * glm::vec3(0.0f, 0.0f, -1.0f);
+        Right = orientation * glm::vec3(1.0f, 0.0f, 0.0f);
+        Up = orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+        dirty = true;
+    }
+
     void updateCameraVectors() {
+        if (quaternionOrientation) {
+            rotateOrientation(0.0f, 0.0f);
+            return;
+        }
+
         glm::vec3 front;
         front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
         front.y = sin(glm::radians(Pitch));
@@ -114,6 +221,7 @@ private:
         
         Right = glm::normalize(glm::cross(Front, WorldUp));
         Up = glm::normalize(glm::cross(Right, Front));
+        dirty = true;
     }
 };
 
@@ -0,0 +1,37 @@
+#include "CameraUniforms.h"
+
+#include <cstddef>
+
+CameraUniforms::CameraUniforms()
+{
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, UBO);
+}
+
+void CameraUniforms::update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, float time) {
+	CameraBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.viewProj = projection * view;
+	block.cameraPos = glm::vec4(cameraPos, 1.0f);
+	block.time = time;
+	block.padding[0] = block.padding[1] = block.padding[2] = 0.0f;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CameraUniforms::updateTime(float time) {
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(CameraBlock, time), sizeof(float), &time);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CameraUniforms::discard() {
+	glDeleteBuffers(1, &UBO);
+}
@@ -0,0 +1,44 @@
+#ifndef CAMERA_UNIFORMS_H
+#define CAMERA_UNIFORMS_H
+
+#include <glad/glad.h>
+
+#include "glm\glm\glm.hpp"
+
+// binding point reserved for the camera block. every Shader with a "CameraData" block is bound to it on creation
+const unsigned int CAMERA_UBO_BINDING = 0;
+
+// mirrors the std140 layout of the block in the shaders:
+//
+// layout (std140) uniform CameraData {
+//     mat4 view;
+//     mat4 projection;
+//     mat4 viewProj;
+//     vec4 cameraPos;  // w unused
+//     float time;
+// };
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProj;
+	glm::vec4 cameraPos;
+	float time;
+	float padding[3];
+};
+
+// one uniform buffer holding the camera matrices, written when the camera changes and shared by every program
+class CameraUniforms
+{
+public:
+	CameraUniforms();
+
+	void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, float time);
+	// only rewrites the time, for frames where the camera did not change
+	void updateTime(float time);
+	void discard();
+
+private:
+	unsigned int UBO;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "ChunkStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+ChunkStreamer::ChunkStreamer(VoxelWorld& world, ThreadPool& pool, const StreamingSettings& settings) : world(world), pool(pool), settings(settings), counters({ 0, 0, 0, 0, 0, false, false })
+{
+}
+
+bool ChunkStreamer::withinRadius(const ChunkCoord& coord, const ChunkCoord& center, int radius) const {
+	int dx = coord.x - center.x, dz = coord.z - center.z;
+	return dx * dx + dz * dz <= radius * radius && coord.y >= settings.minChunkY && coord.y <= settings.maxChunkY;
+}
+
+void ChunkStreamer::update(const glm::vec3& cameraPosition, const glm::vec3& cameraFront) {
+	const int N = Chunk::SIZE;
+	ChunkCoord center = VoxelWorld::chunkOf((int)std::floor(cameraPosition.x), (int)std::floor(cameraPosition.y), (int)std::floor(cameraPosition.z));
+
+	counters.loadedLastUpdate = counters.unloadedLastUpdate = 0;
+
+	// hands finished chunks to the world, unless the camera has moved away from them meanwhile
+	std::vector<Chunk> done;
+	{
+		std::lock_guard<std::mutex> lock(generatedMutex);
+		done.swap(generated);
+	}
+	for (Chunk& chunk : done) {
+		loading.erase(chunk.coord);
+		if (withinRadius(chunk.coord, center, settings.unloadRadius)) {
+			world.insertChunk(std::move(chunk));
+			counters.loadedLastUpdate++;
+		}
+	}
+
+	world.chunkInfo(info);
+	for (const VoxelWorld::ChunkInfo& chunk : info) {
+		if (!withinRadius(chunk.coord, center, settings.unloadRadius)) {
+			world.removeChunk(chunk.coord);
+			counters.unloadedLastUpdate++;
+		}
+	}
+
+	enforceBudgets(center);
+
+	// missing chunks by distance, stretched behind the camera so the view fills in first
+	candidates.clear();
+	glm::vec3 front = glm::length(cameraFront) > 0.0f ? glm::normalize(cameraFront) : glm::vec3(0.0f, 0.0f, -1.0f);
+	for (int y = settings.minChunkY; y <= settings.maxChunkY; y++) {
+		for (int z = center.z - settings.loadRadius; z <= center.z + settings.loadRadius; z++) {
+			for (int x = center.x - settings.loadRadius; x <= center.x + settings.loadRadius; x++) {
+				ChunkCoord coord = { x, y, z };
+				if (!withinRadius(coord, center, settings.loadRadius) || world.hasChunk(coord) || loading.count(coord))
+					continue;
+
+				glm::vec3 toChunk = (glm::vec3((float)x, (float)y, (float)z) + glm::vec3(0.5f)) * (float)N - cameraPosition;
+				float distance = glm::length(toChunk);
+				float facing = distance > 0.0f ? glm::dot(toChunk, front) / distance : 1.0f;
+				candidates.push_back({ coord, distance * (1.5f - 0.5f * facing) });
+			}
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority < b.priority; });
+
+	size_t chunkBytes = sizeof(BlockID) * Chunk::VOLUME;
+	for (const Candidate& candidate : candidates) {
+		if (loading.size() >= settings.maxLoadsInFlight)
+			break;
+		// what is loaded and loading has to fit, otherwise the budget eviction would throw out what was just streamed in
+		if (world.cpuBytes() + (loading.size() + 1) * chunkBytes > settings.cpuBudgetBytes)
+			break;
+
+		loading.insert(candidate.coord);
+		ChunkCoord coord = candidate.coord;
+		pool.submit([this, coord]() {
+			Chunk chunk;
+			chunk.coord = coord;
+			VoxelWorld::generateTerrain(chunk);
+
+			std::lock_guard<std::mutex> lock(generatedMutex);
+			generated.push_back(std::move(chunk));
+		});
+	}
+	counters.loadsInFlight = (unsigned int)loading.size();
+}
+
+void ChunkStreamer::enforceBudgets(const ChunkCoord& center) {
+	counters.evictedLastUpdate = counters.meshesEvictedLastUpdate = 0;
+	counters.cpuBudgetExceeded = counters.gpuBudgetExceeded = false;
+	if (world.cpuBytes() <= settings.cpuBudgetBytes && world.gpuBytes() <= settings.gpuBudgetBytes)
+		return;
+
+	// least recently drawn first, the farther one when two were drawn in the same frame
+	world.chunkInfo(info);
+	auto distance = [&center](const ChunkCoord& c) {
+		int dx = c.x - center.x, dy = c.y - center.y, dz = c.z - center.z;
+		return dx * dx + dy * dy + dz * dz;
+	};
+	std::sort(info.begin(), info.end(), [&distance](const VoxelWorld::ChunkInfo& a, const VoxelWorld::ChunkInfo& b) {
+		if (a.lastDrawn != b.lastDrawn)
+			return a.lastDrawn < b.lastDrawn;
+		return distance(a.coord) > distance(b.coord);
+	});
+
+	for (const VoxelWorld::ChunkInfo& chunk : info) {
+		if (world.cpuBytes() <= settings.cpuBudgetBytes)
+			break;
+		// sorted oldest first, so everything from here on is in view
+		if (chunk.lastDrawn + 1 >= world.frame())
+			break;
+		world.removeChunk(chunk.coord);
+		counters.evictedLastUpdate++;
+	}
+	counters.cpuBudgetExceeded = world.cpuBytes() > settings.cpuBudgetBytes;
+
+	for (const VoxelWorld::ChunkInfo& chunk : info) {
+		if (world.gpuBytes() <= settings.gpuBudgetBytes)
+			break;
+		if (chunk.gpuBytes == 0 || !world.hasChunk(chunk.coord))
+			continue;
+		// sorted oldest first, so everything from here on is in view
+		if (chunk.lastDrawn + 1 >= world.frame())
+			break;
+		world.releaseMesh(chunk.coord);
+		counters.meshesEvictedLastUpdate++;
+	}
+	counters.gpuBudgetExceeded = world.gpuBytes() > settings.gpuBudgetBytes;
+}
+
+void ChunkStreamer::discard() {
+	pool.wait();
+	std::lock_guard<std::mutex> lock(generatedMutex);
+	generated.clear();
+	loading.clear();
+}
@@ -0,0 +1,76 @@
+#ifndef CHUNK_STREAMER_H
+#define CHUNK_STREAMER_H
+
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "VoxelWorld.h"
+#include "ThreadPool.h"
+
+struct StreamingSettings {
+	// in chunks, horizontally around the camera. unloadRadius is larger so walking along a border does not reload chunks
+	int loadRadius = 8;
+	int unloadRadius = 10;
+	// chunk layers that are streamed at all
+	int minChunkY = -1;
+	int maxChunkY = 0;
+	// chunks generated on the workers at the same time
+	unsigned int maxLoadsInFlight = 8;
+	size_t cpuBudgetBytes = 64u << 20;
+	size_t gpuBudgetBytes = 64u << 20;
+};
+
+// keeps the chunks around the camera loaded. chunks are generated on the thread pool nearest first, with the ones in front
+// of the camera ahead of the ones behind it, and handed to the world as they finish, so nothing is generated on the main thread.
+// chunks past the unload radius are dropped. when block data goes over the cpu budget the least recently drawn chunks are
+// unloaded, and when meshes go over the gpu budget the least recently drawn meshes are freed. chunks and meshes that were drawn
+// last frame are never evicted, they would only be loaded or meshed again right away, so if those alone do not fit the budget
+// is reported as exceeded
+class ChunkStreamer
+{
+public:
+	struct Stats {
+		unsigned int loadsInFlight;
+		unsigned int loadedLastUpdate;
+		unsigned int unloadedLastUpdate;
+		unsigned int evictedLastUpdate;
+		unsigned int meshesEvictedLastUpdate;
+		// the chunks in view alone are over cpuBudgetBytes
+		bool cpuBudgetExceeded;
+		// the meshes in view alone are over gpuBudgetBytes
+		bool gpuBudgetExceeded;
+	};
+
+	ChunkStreamer(VoxelWorld& world, ThreadPool& pool, const StreamingSettings& settings = StreamingSettings());
+
+	// call once per frame before world.update()
+	void update(const glm::vec3& cameraPosition, const glm::vec3& cameraFront);
+	// waits for the generation jobs, they point at this streamer
+	void discard();
+
+	const Stats& stats() const { return counters; }
+
+private:
+	struct Candidate {
+		ChunkCoord coord;
+		float priority;
+	};
+
+	VoxelWorld& world;
+	ThreadPool& pool;
+	StreamingSettings settings;
+
+	std::unordered_set<ChunkCoord, ChunkCoordHash> loading;
+	std::mutex generatedMutex;
+	std::vector<Chunk> generated;
+
+	std::vector<Candidate> candidates;
+	std::vector<VoxelWorld::ChunkInfo> info;
+	Stats counters;
+
+	bool withinRadius(const ChunkCoord& coord, const ChunkCoord& center, int radius) const;
+	void enforceBudgets(const ChunkCoord& center);
+};
+
+#endif
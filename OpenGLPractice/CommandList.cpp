@@ -0,0 +1,129 @@
+#include "CommandList.h"
+#include "GLStateCache.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "glm\glm\gtc\type_ptr.hpp"
+
+// payloads, kept trivially copyable so they can be memcpy'd in and out of the stream
+struct BindTextureCmd { unsigned int unit; unsigned int texture; };
+struct UniformIntCmd { int location; int value; };
+struct UniformFloatCmd { int location; float value; };
+struct UniformMat4Cmd { int location; float value[16]; };
+struct DrawArraysCmd { GLenum mode; GLint first; GLsizei count; GLsizei instanceCount; };
+
+// every command is a one byte type followed by its payload
+template<typename T>
+void CommandList::write(CommandType type, const T& payload) {
+	size_t at = stream.size();
+	stream.resize(at + 1 + sizeof(T));
+	stream[at] = type;
+	std::memcpy(&stream[at + 1], &payload, sizeof(T));
+	commands++;
+}
+
+template<typename T>
+static T read(const uint8_t*& cursor) {
+	T payload;
+	std::memcpy(&payload, cursor, sizeof(T));
+	cursor += sizeof(T);
+	return payload;
+}
+
+void CommandList::useProgram(unsigned int program) {
+	write(CMD_USE_PROGRAM, program);
+}
+
+void CommandList::bindVertexArray(unsigned int VAO) {
+	write(CMD_BIND_VERTEX_ARRAY, VAO);
+}
+
+void CommandList::bindTexture(unsigned int unit, unsigned int texture) {
+	write(CMD_BIND_TEXTURE, BindTextureCmd{ unit, texture });
+}
+
+void CommandList::setInt(int location, int value) {
+	write(CMD_UNIFORM_INT, UniformIntCmd{ location, value });
+}
+
+void CommandList::setFloat(int location, float value) {
+	write(CMD_UNIFORM_FLOAT, UniformFloatCmd{ location, value });
+}
+
+void CommandList::setMat4(int location, const glm::mat4& value) {
+	UniformMat4Cmd cmd;
+	cmd.location = location;
+	std::memcpy(cmd.value, glm::value_ptr(value), sizeof(cmd.value));
+	write(CMD_UNIFORM_MAT4, cmd);
+}
+
+void CommandList::drawArrays(GLenum mode, GLint first, GLsizei count) {
+	write(CMD_DRAW_ARRAYS, DrawArraysCmd{ mode, first, count, 1 });
+}
+
+void CommandList::drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) {
+	write(CMD_DRAW_ARRAYS_INSTANCED, DrawArraysCmd{ mode, first, count, instanceCount });
+}
+
+void CommandList::execute() const {
+	const uint8_t* cursor = stream.data();
+	const uint8_t* end = cursor + stream.size();
+
+	while (cursor < end) {
+		CommandType type = (CommandType)*cursor++;
+
+		switch (type) {
+		case CMD_USE_PROGRAM:
+			glState.useProgram(read<unsigned int>(cursor));
+			break;
+		case CMD_BIND_VERTEX_ARRAY:
+			glState.bindVertexArray(read<unsigned int>(cursor));
+			break;
+		case CMD_BIND_TEXTURE: {
+			BindTextureCmd cmd = read<BindTextureCmd>(cursor);
+			glState.bindTexture(cmd.unit, cmd.texture);
+			break;
+		}
+		case CMD_UNIFORM_INT: {
+			UniformIntCmd cmd = read<UniformIntCmd>(cursor);
+			glUniform1i(cmd.location, cmd.value);
+			break;
+		}
+		case CMD_UNIFORM_FLOAT: {
+			UniformFloatCmd cmd = read<UniformFloatCmd>(cursor);
+			glUniform1f(cmd.location, cmd.value);
+			break;
+		}
+		case CMD_UNIFORM_MAT4: {
+			UniformMat4Cmd cmd = read<UniformMat4Cmd>(cursor);
+			glUniformMatrix4fv(cmd.location, 1, GL_FALSE, cmd.value);
+			break;
+		}
+		case CMD_DRAW_ARRAYS: {
+			DrawArraysCmd cmd = read<DrawArraysCmd>(cursor);
+			glDrawArrays(cmd.mode, cmd.first, cmd.count);
+			break;
+		}
+		case CMD_DRAW_ARRAYS_INSTANCED: {
+			DrawArraysCmd cmd = read<DrawArraysCmd>(cursor);
+			glDrawArraysInstanced(cmd.mode, cmd.first, cmd.count, cmd.instanceCount);
+			break;
+		}
+		default:
+			std::cout << "ERROR::COMMAND_LIST::UNKNOWN_COMMAND " << (int)type << " at byte " << (cursor - 1 - stream.data()) << std::endl;
+			return;
+		}
+	}
+}
+
+void CommandList::clear() {
+	stream.clear();
+	commands = 0;
+}
+
+void recordInParallel(ThreadPool& pool, std::vector<CommandList>& lists, const std::function<void(CommandList&, unsigned int)>& record) {
+	pool.parallelFor((unsigned int)lists.size(), [&lists, &record](unsigned int i) {
+		record(lists[i], i);
+	});
+}
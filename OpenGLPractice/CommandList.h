@@ -0,0 +1,58 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "ThreadPool.h"
+
+enum CommandType : uint8_t {
+	CMD_USE_PROGRAM,
+	CMD_BIND_VERTEX_ARRAY,
+	CMD_BIND_TEXTURE,
+	CMD_UNIFORM_INT,
+	CMD_UNIFORM_FLOAT,
+	CMD_UNIFORM_MAT4,
+	CMD_DRAW_ARRAYS,
+	CMD_DRAW_ARRAYS_INSTANCED
+};
+
+// a list of draw, bind and uniform commands packed into a byte stream.
+// recording only touches the list itself, so any thread can fill one without a GL context.
+// execute() replays it in order and must run on the thread that owns the context.
+// uniforms are addressed by location, look them up once on the GL thread before recording
+class CommandList
+{
+public:
+	void useProgram(unsigned int program);
+	void bindVertexArray(unsigned int VAO);
+	void bindTexture(unsigned int unit, unsigned int texture);
+	void setInt(int location, int value);
+	void setFloat(int location, float value);
+	void setMat4(int location, const glm::mat4& value);
+	void drawArrays(GLenum mode, GLint first, GLsizei count);
+	void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+
+	// stops at the first byte that is not a command, nothing after it can be trusted
+	void execute() const;
+	void clear();
+
+	size_t size() const { return stream.size(); }
+	unsigned int commandCount() const { return commands; }
+
+private:
+	std::vector<uint8_t> stream;
+	unsigned int commands = 0;
+
+	template<typename T>
+	void write(CommandType type, const T& payload);
+};
+
+// records every lists[i] with record(lists[i], i), spread over the pool and the calling thread, and waits for all of them.
+// replaying the lists in index order afterwards gives the same result as recording them one after another
+void recordInParallel(ThreadPool& pool, std::vector<CommandList>& lists, const std::function<void(CommandList&, unsigned int)>& record);
+
+#endif
@@ -0,0 +1,64 @@
+#include "DepthPrepass.h"
+#include "GLStateCache.h"
+
+DepthPrepass::DepthPrepass(const char* vertexPath, const char* depthFragmentPath) : depthShader(vertexPath, depthFragmentPath), enabled(true), frame(0), lastShaded(0)
+{
+	glGenQueries(2, queries);
+	queryPending[0] = queryPending[1] = false;
+}
+
+void DepthPrepass::render(const std::function<void(Shader* override)>& draw) {
+	unsigned int current = frame % 2;
+
+	// the query of the last frame normally finished while this one was being recorded
+	unsigned int previous = (frame + 1) % 2;
+	if (queryPending[previous]) {
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			glGetQueryObjectui64v(queries[previous], GL_QUERY_RESULT, &lastShaded);
+			queryPending[previous] = false;
+		}
+	}
+
+	glState.setDepthTest(true);
+
+	if (enabled) {
+		glState.setColorMask(false);
+		glState.setDepthMask(true);
+		glState.setDepthFunc(GL_LESS);
+		draw(&depthShader);
+
+		glState.setColorMask(true);
+		glState.setDepthMask(false);
+		glState.setDepthFunc(GL_EQUAL);
+	}
+
+	bool counting = !queryPending[current];
+	if (counting)
+		glBeginQuery(GL_SAMPLES_PASSED, queries[current]);
+
+	draw(nullptr);
+
+	if (counting) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		queryPending[current] = true;
+	}
+
+	// leaves the default state behind so the next clear still clears depth
+	glState.setDepthMask(true);
+	glState.setDepthFunc(GL_LESS);
+
+	frame++;
+}
+
+float DepthPrepass::shadedFragmentsPerPixel(int width, int height) const {
+	if (width <= 0 || height <= 0)
+		return 0.0f;
+	return (float)lastShaded / (float)(width * height);
+}
+
+void DepthPrepass::discard() {
+	depthShader.discard();
+	glDeleteQueries(2, queries);
+}
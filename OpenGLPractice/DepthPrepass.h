@@ -0,0 +1,41 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <glad/glad.h>
+
+#include <functional>
+#include "shader.h"
+
+// optional depth-only pass before shading. the scene is drawn once with colour writes off and a trivial fragment shader,
+// then shaded with GL_EQUAL depth test and depth writes off, so every pixel runs the real fragment shader at most once.
+// the vertex shader used by both passes must declare gl_Position invariant.
+//
+// samples passing the shading pass are counted with an occlusion query, read one frame late so it never stalls
+class DepthPrepass
+{
+public:
+	DepthPrepass(const char* vertexPath, const char* depthFragmentPath);
+
+	// draw(override) must draw the opaque scene, using override instead of its own shaders when it is not null
+	void render(const std::function<void(Shader* override)>& draw);
+
+	void setEnabled(bool enabled) { this->enabled = enabled; }
+	bool isEnabled() const { return enabled; }
+
+	// fragments that passed the depth test in the shading pass of the last finished frame
+	GLuint64 shadedFragments() const { return lastShaded; }
+	float shadedFragmentsPerPixel(int width, int height) const;
+
+	void discard();
+
+private:
+	Shader depthShader;
+	bool enabled;
+
+	unsigned int queries[2];
+	bool queryPending[2];
+	unsigned int frame;
+	GLuint64 lastShaded;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "FixedTimestep.h"
+#include "Camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+FixedTimestep::FixedTimestep(double rate, unsigned int maxSteps) : maxSteps(maxSteps)
+{
+	setRate(rate);
+}
+
+void FixedTimestep::setRate(double rate) {
+	stepSeconds = 1.0 / rate;
+	accumulator = std::min(accumulator, stepSeconds);
+}
+
+unsigned int FixedTimestep::advance(double frameSeconds) {
+	accumulator += std::max(frameSeconds, 0.0);
+
+	unsigned int count = (unsigned int)std::min(accumulator / stepSeconds, (double)maxSteps);
+	accumulator -= count * stepSeconds;
+
+	// still more than a step behind after the cap, the rest is dropped
+	if (accumulator >= stepSeconds) {
+		dropped += accumulator - std::fmod(accumulator, stepSeconds);
+		accumulator = std::fmod(accumulator, stepSeconds);
+	}
+
+	steps += count;
+	return count;
+}
+
+namespace {
+	// forward, right, back, left for 1.5 seconds each, while slowly turning
+	void walk(Camera& camera, float time, float dt) {
+		const Camera_Movement legs[] = { FORWARD, RIGHT, BACKWARD, LEFT };
+		camera.ProcessKeyboard(legs[(int)(time / 1.5f) % 4], dt);
+		camera.ProcessMouseMovement(30.0f * dt / camera.MouseSensitivity, 0.0f);
+	}
+}
+
+TimestepBenchmarkResult FixedTimestepBenchmark::run(double rate, float seconds) {
+	TimestepBenchmarkResult result;
+	result.stepCount = (unsigned int)(seconds * rate);
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> jitter(1.0 / 200.0, 1.0 / 20.0);
+	std::vector<double> jittery;
+	for (double total = 0.0; total < seconds + 1.0; total += jittery.back())
+		jittery.push_back(jitter(rng));
+
+	const unsigned int PATTERN_COUNT = 3;
+	auto frameTime = [&](unsigned int pattern, size_t frame) {
+		if (pattern == 0)
+			return 1.0 / 30.0;
+		if (pattern == 1)
+			return 1.0 / 144.0;
+		return jittery[frame % jittery.size()];
+	};
+
+	glm::vec3 fixedEnds[PATTERN_COUNT], variableEnds[PATTERN_COUNT];
+	double totalMs = 0.0;
+	for (unsigned int pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+		Camera camera;
+		FixedTimestep timestep(rate, 1000);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t frame = 0; timestep.stepCount() < result.stepCount; frame++) {
+			unsigned long long first = timestep.stepCount();
+			unsigned int count = timestep.advance(frameTime(pattern, frame));
+			for (unsigned long long s = first; s < first + count && s < result.stepCount; s++)
+				walk(camera, (float)s * timestep.step(), timestep.step());
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+		fixedEnds[pattern] = camera.Position;
+
+		Camera variable;
+		double time = 0.0;
+		for (size_t frame = 0; time < seconds; frame++) {
+			double dt = std::min(frameTime(pattern, frame), seconds - time);
+			walk(variable, (float)time, (float)dt);
+			time += dt;
+		}
+		variableEnds[pattern] = variable.Position;
+	}
+
+	result.simulatedSeconds = (float)(result.stepCount / rate);
+	result.fixedStepsMatch = true;
+	result.variableStepSpread = 0.0f;
+	for (unsigned int pattern = 1; pattern < PATTERN_COUNT; pattern++) {
+		result.fixedStepsMatch = result.fixedStepsMatch && std::memcmp(&fixedEnds[0], &fixedEnds[pattern], sizeof(glm::vec3)) == 0;
+		result.variableStepSpread = std::max(result.variableStepSpread, glm::length(variableEnds[pattern] - variableEnds[0]));
+	}
+	result.msPerStep = totalMs / (PATTERN_COUNT * (double)result.stepCount);
+	return result;
+}
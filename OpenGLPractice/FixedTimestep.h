@@ -0,0 +1,51 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+// turns the real time between frames into a whole number of equal simulation steps.
+// whatever is left over carries into the next frame, and alpha() says how far into the next step the frame is,
+// so the renderer can blend the last two simulated states instead of showing the simulation stutter
+class FixedTimestep
+{
+public:
+	// rate in steps per second. at most maxSteps run per frame, past that the simulation falls behind real time
+	// instead of every following frame trying to catch up
+	explicit FixedTimestep(double rate = 60.0, unsigned int maxSteps = 8);
+
+	void setRate(double rate);
+	double rate() const { return 1.0 / stepSeconds; }
+	// the same for every step, so the simulation does not depend on the frame rate
+	float step() const { return (float)stepSeconds; }
+
+	// adds the time the last frame took and returns how many steps to run now
+	unsigned int advance(double frameSeconds);
+	// 0 to 1, how much of the next step the real time has already covered
+	float alpha() const { return (float)(accumulator / stepSeconds); }
+
+	unsigned long long stepCount() const { return steps; }
+	// real time thrown away because a frame needed more than maxSteps
+	double droppedSeconds() const { return dropped; }
+
+private:
+	double stepSeconds;
+	unsigned int maxSteps;
+	double accumulator = 0.0;
+	double dropped = 0.0;
+	unsigned long long steps = 0;
+};
+
+struct TimestepBenchmarkResult {
+	unsigned int stepCount;
+	float simulatedSeconds;
+	// the same scripted walk with the same steps, once per frame rate pattern
+	bool fixedStepsMatch;
+	// the walk integrated with the raw frame time instead, ends up somewhere else at every frame rate
+	float variableStepSpread;
+	double msPerStep;
+};
+
+namespace FixedTimestepBenchmark {
+	// walks a camera along a scripted path at 30 fps, 144 fps and a jittery rate from a fixed seed
+	TimestepBenchmarkResult run(double rate, float seconds);
+}
+
+#endif
@@ -0,0 +1,375 @@
+#include "FrameGraph.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+FrameGraphResource FrameGraphBuilder::create(const std::string& name, const FrameGraphTextureDesc& desc) {
+	graph.resources.push_back({ name, desc, false, -1, -1, -1 });
+	return (FrameGraphResource)graph.resources.size() - 1;
+}
+
+FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource) {
+	graph.passes[pass].reads.push_back(resource);
+	return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::write(FrameGraphResource resource) {
+	graph.passes[pass].writes.push_back(resource);
+	return resource;
+}
+
+void FrameGraphBuilder::setSideEffect() {
+	graph.passes[pass].sideEffect = true;
+}
+
+unsigned int FrameGraphContext::texture(FrameGraphResource resource) const {
+	int physical = graph.resources[resource].physical;
+	return physical < 0 ? 0 : graph.pool[physical].texture;
+}
+
+unsigned int FrameGraphContext::framebuffer(const std::vector<FrameGraphResource>& attachments) const {
+	return graph.framebufferFor(attachments, "context");
+}
+
+FrameGraphResource FrameGraph::importBackbuffer(const std::string& name, int width, int height) {
+	resources.push_back({ name, { width, height, GL_RGBA8 }, true, -1, -1, -1 });
+	return (FrameGraphResource)resources.size() - 1;
+}
+
+void FrameGraph::addPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute) {
+	passes.push_back({ name, execute, {}, {}, false, false });
+	FrameGraphBuilder builder(*this, (unsigned int)passes.size() - 1);
+	setup(builder);
+}
+
+// the writers of a resource run in the order they were added, and everything that only reads it runs after the last writer.
+// passes that do not depend on each other keep the order they were added in
+void FrameGraph::sortPasses() {
+	size_t passCount = passes.size();
+	std::vector<std::vector<unsigned int>> dependents(passCount);
+	std::vector<unsigned int> dependencies(passCount, 0);
+
+	auto addEdge = [&](unsigned int from, unsigned int to) {
+		dependents[from].push_back(to);
+		dependencies[to]++;
+	};
+
+	for (FrameGraphResource r = 0; r < resources.size(); r++) {
+		std::vector<unsigned int> writers;
+		for (unsigned int p = 0; p < passCount; p++) {
+			if (std::find(passes[p].writes.begin(), passes[p].writes.end(), r) != passes[p].writes.end())
+				writers.push_back(p);
+		}
+
+		for (size_t w = 1; w < writers.size(); w++)
+			addEdge(writers[w - 1], writers[w]);
+
+		for (unsigned int p = 0; p < passCount; p++) {
+			bool reads = std::find(passes[p].reads.begin(), passes[p].reads.end(), r) != passes[p].reads.end();
+			bool writes = std::find(writers.begin(), writers.end(), p) != writers.end();
+			if (!reads || writes)
+				continue;
+			for (unsigned int writer : writers)
+				addEdge(writer, p);
+		}
+	}
+
+	order.clear();
+	std::vector<bool> placed(passCount, false);
+	for (size_t step = 0; step < passCount; step++) {
+		unsigned int next = (unsigned int)passCount;
+		for (unsigned int p = 0; p < passCount; p++) {
+			if (!placed[p] && dependencies[p] == 0) {
+				next = p;
+				break;
+			}
+		}
+
+		if (next == passCount) {
+			std::cout << "ERROR::FRAMEGRAPH::DEPENDENCY_CYCLE, falling back to the order passes were added in" << std::endl;
+			order.clear();
+			for (unsigned int p = 0; p < passCount; p++)
+				order.push_back(p);
+			return;
+		}
+
+		placed[next] = true;
+		order.push_back(next);
+		for (unsigned int dependent : dependents[next])
+			dependencies[dependent]--;
+	}
+}
+
+// a pass survives if it writes an imported target or has a side effect, or produces something a surviving pass reads
+void FrameGraph::cullPasses() {
+	std::vector<unsigned int> work;
+	for (unsigned int p = 0; p < passes.size(); p++) {
+		Pass& pass = passes[p];
+		pass.alive = pass.sideEffect;
+		for (FrameGraphResource r : pass.writes) {
+			if (resources[r].imported)
+				pass.alive = true;
+		}
+		if (pass.alive)
+			work.push_back(p);
+	}
+
+	while (!work.empty()) {
+		unsigned int consumer = work.back();
+		work.pop_back();
+
+		for (FrameGraphResource r : passes[consumer].reads) {
+			for (unsigned int p = 0; p < passes.size(); p++) {
+				Pass& producer = passes[p];
+				if (producer.alive)
+					continue;
+				if (std::find(producer.writes.begin(), producer.writes.end(), r) != producer.writes.end()) {
+					producer.alive = true;
+					work.push_back(p);
+				}
+			}
+		}
+	}
+
+	culledPasses = 0;
+	for (const Pass& pass : passes) {
+		if (!pass.alive)
+			culledPasses++;
+	}
+}
+
+// walks the surviving passes in order, taking a pooled texture at a resource's first use and giving it back after its last
+void FrameGraph::assignTextures() {
+	for (Resource& resource : resources) {
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+		resource.physical = -1;
+	}
+
+	for (int position = 0; position < (int)order.size(); position++) {
+		const Pass& pass = passes[order[position]];
+		if (!pass.alive)
+			continue;
+
+		auto touch = [&](FrameGraphResource r) {
+			if (resources[r].firstUse < 0)
+				resources[r].firstUse = position;
+			resources[r].lastUse = position;
+		};
+		for (FrameGraphResource r : pass.reads)
+			touch(r);
+		for (FrameGraphResource r : pass.writes)
+			touch(r);
+	}
+
+	std::vector<bool> inUse(pool.size(), false);
+	std::vector<bool> usedThisFrame(pool.size(), false);
+	aliasedResources = 0;
+
+	for (int position = 0; position < (int)order.size(); position++) {
+		for (Resource& resource : resources) {
+			if (resource.imported || resource.firstUse != position)
+				continue;
+
+			int physical = -1;
+			for (size_t t = 0; t < pool.size(); t++) {
+				if (!inUse[t] && pool[t].desc == resource.desc) {
+					physical = (int)t;
+					break;
+				}
+			}
+			if (physical < 0) {
+				pool.push_back({ resource.desc, createTexture(resource.desc), compileCount });
+				inUse.push_back(false);
+				usedThisFrame.push_back(false);
+				physical = (int)pool.size() - 1;
+			}
+
+			if (usedThisFrame[physical])
+				aliasedResources++;
+			inUse[physical] = true;
+			usedThisFrame[physical] = true;
+			pool[physical].lastCompile = compileCount;
+			resource.physical = physical;
+		}
+
+		for (Resource& resource : resources) {
+			if (!resource.imported && resource.lastUse == position)
+				inUse[resource.physical] = false;
+		}
+	}
+}
+
+// runs before any resource of this compile points into the pool, so removing entries cannot leave a stale index behind
+void FrameGraph::evictUnusedTextures() {
+	size_t kept = 0;
+	for (size_t t = 0; t < pool.size(); t++) {
+		if (compileCount - pool[t].lastCompile <= POOL_KEEP_COMPILES) {
+			pool[kept++] = pool[t];
+			continue;
+		}
+
+		unsigned int texture = pool[t].texture;
+		for (auto framebuffer = framebuffers.begin(); framebuffer != framebuffers.end();) {
+			const std::vector<unsigned int>& attached = framebuffer->first;
+			if (std::find(attached.begin(), attached.end(), texture) != attached.end()) {
+				glDeleteFramebuffers(1, &framebuffer->second);
+				framebuffer = framebuffers.erase(framebuffer);
+			}
+			else {
+				framebuffer++;
+			}
+		}
+		glState.deleteTexture(texture);
+	}
+	pool.resize(kept);
+}
+
+void FrameGraph::compile() {
+	compileCount++;
+	sortPasses();
+	cullPasses();
+	evictUnusedTextures();
+	assignTextures();
+}
+
+bool FrameGraph::isDepthFormat(GLenum format) {
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F || hasStencil(format);
+}
+
+bool FrameGraph::hasStencil(GLenum format) {
+	return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+unsigned int FrameGraph::createTexture(const FrameGraphTextureDesc& desc) {
+	// no data is uploaded, but the external format and type still have to be valid for the internal format
+	GLenum format = GL_RGBA;
+	GLenum type = GL_UNSIGNED_BYTE;
+	if (desc.format == GL_DEPTH24_STENCIL8) {
+		format = GL_DEPTH_STENCIL;
+		type = GL_UNSIGNED_INT_24_8;
+	}
+	else if (desc.format == GL_DEPTH32F_STENCIL8) {
+		format = GL_DEPTH_STENCIL;
+		type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+	}
+	else if (isDepthFormat(desc.format)) {
+		format = GL_DEPTH_COMPONENT;
+		type = GL_FLOAT;
+	}
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glState.bindTextureForEdit(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+// one framebuffer per combination of attached textures, made on first use and kept with the pool
+unsigned int FrameGraph::framebufferFor(const std::vector<FrameGraphResource>& attachments, const std::string& name) {
+	std::vector<unsigned int> key;
+	for (FrameGraphResource r : attachments) {
+		if (resources[r].imported)
+			return 0;
+		key.push_back(pool[resources[r].physical].texture);
+	}
+
+	auto found = framebuffers.find(key);
+	if (found != framebuffers.end())
+		return found->second;
+
+	unsigned int FBO;
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+	std::vector<GLenum> drawBuffers;
+	for (FrameGraphResource r : attachments) {
+		const Resource& resource = resources[r];
+		unsigned int texture = pool[resource.physical].texture;
+
+		if (hasStencil(resource.desc.format))
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+		else if (isDepthFormat(resource.desc.format))
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+		else {
+			GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			drawBuffers.push_back(attachment);
+		}
+	}
+
+	if (drawBuffers.empty()) {
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	else {
+		glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEGRAPH::FRAMEBUFFER_INCOMPLETE::" << name << std::endl;
+
+	framebuffers[key] = FBO;
+	return FBO;
+}
+
+void FrameGraph::execute() {
+	FrameGraphContext context(*this);
+
+	for (int position = 0; position < (int)order.size(); position++) {
+		const Pass& pass = passes[order[position]];
+		if (!pass.alive)
+			continue;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebufferFor(pass.writes, pass.name));
+
+		// aliased targets hold whatever the previous owner left, so every target is cleared on its first write
+		GLbitfield clearMask = 0;
+		for (FrameGraphResource r : pass.writes) {
+			const Resource& resource = resources[r];
+			if (resource.firstUse != position)
+				continue;
+			if (isDepthFormat(resource.desc.format))
+				clearMask |= GL_DEPTH_BUFFER_BIT | (hasStencil(resource.desc.format) ? GL_STENCIL_BUFFER_BIT : 0);
+			else
+				clearMask |= GL_COLOR_BUFFER_BIT | (resource.imported ? GL_DEPTH_BUFFER_BIT : 0);
+		}
+
+		if (!pass.writes.empty()) {
+			const FrameGraphTextureDesc& target = resources[pass.writes[0]].desc;
+			glViewport(0, 0, target.width, target.height);
+		}
+
+		if (clearMask) {
+			glState.setColorMask(true);
+			glState.setDepthMask(true);
+			glClear(clearMask);
+		}
+
+		pass.execute(context);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameGraph::reset() {
+	resources.clear();
+	passes.clear();
+	order.clear();
+}
+
+void FrameGraph::discard() {
+	for (auto& framebuffer : framebuffers)
+		glDeleteFramebuffers(1, &framebuffer.second);
+	framebuffers.clear();
+
+	for (PooledTexture& pooled : pool)
+		glState.deleteTexture(pooled.texture);
+	pool.clear();
+	reset();
+}
@@ -0,0 +1,142 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef unsigned int FrameGraphResource;
+
+// size and internal format of a render target. depth formats become depth (or depth stencil) attachments
+struct FrameGraphTextureDesc {
+	int width;
+	int height;
+	GLenum format;
+
+	bool operator==(const FrameGraphTextureDesc& other) const {
+		return width == other.width && height == other.height && format == other.format;
+	}
+};
+
+class FrameGraph;
+
+// handed to a pass while it is set up, to declare what it reads and writes
+class FrameGraphBuilder
+{
+public:
+	FrameGraphResource create(const std::string& name, const FrameGraphTextureDesc& desc);
+	FrameGraphResource read(FrameGraphResource resource);
+	FrameGraphResource write(FrameGraphResource resource);
+	// keeps the pass even if nothing reads what it writes, e.g. a readback or a debug output
+	void setSideEffect();
+
+private:
+	friend class FrameGraph;
+	FrameGraphBuilder(FrameGraph& graph, unsigned int pass) : graph(graph), pass(pass) {}
+
+	FrameGraph& graph;
+	unsigned int pass;
+};
+
+// handed to a pass while it executes, to find the GL textures behind the resources it declared
+class FrameGraphContext
+{
+public:
+	unsigned int texture(FrameGraphResource resource) const;
+	// the framebuffer with these targets attached, e.g. to bind as GL_READ_FRAMEBUFFER and blit from.
+	// making a new one binds it, so bind the framebuffers the pass needs after asking
+	unsigned int framebuffer(const std::vector<FrameGraphResource>& attachments) const;
+
+private:
+	friend class FrameGraph;
+	FrameGraphContext(FrameGraph& graph) : graph(graph) {}
+
+	FrameGraph& graph;
+};
+
+// describes a frame as passes that declare the attachments they read and write.
+// compile() orders the passes by their dependencies, culls the ones that contribute nothing to an imported target,
+// and assigns the transient targets textures from a pool, letting targets whose lifetimes do not overlap share one.
+// execute() binds a framebuffer per pass, clears every target on its first write and runs the passes.
+//
+// rebuild the graph every frame with reset(), the texture pool and framebuffers are kept between frames.
+// pooled textures no resource was given for POOL_KEEP_COMPILES compiles in a row are deleted together with their framebuffers,
+// so targets left behind by a resize or a pass that went away do not pile up.
+// GL orders render to texture followed by sampling on its own, so no explicit barriers are needed between passes
+class FrameGraph
+{
+public:
+	typedef std::function<void(FrameGraphBuilder&)> SetupFunction;
+	typedef std::function<void(const FrameGraphContext&)> ExecuteFunction;
+
+	// the default framebuffer. passes writing it are never culled
+	FrameGraphResource importBackbuffer(const std::string& name, int width, int height);
+
+	void addPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+	void compile();
+	void execute();
+	// drops the passes and resources of this frame, keeps the pooled textures and framebuffers
+	void reset();
+	void discard();
+
+	unsigned int culledPassCount() const { return culledPasses; }
+	unsigned int pooledTextureCount() const { return (unsigned int)pool.size(); }
+	// transient resources that got a texture another resource already used earlier this frame
+	unsigned int aliasedResourceCount() const { return aliasedResources; }
+
+private:
+	friend class FrameGraphBuilder;
+	friend class FrameGraphContext;
+
+	struct Resource {
+		std::string name;
+		FrameGraphTextureDesc desc;
+		bool imported;
+		int firstUse;
+		int lastUse;
+		int physical; // index into the pool, -1 for the backbuffer or unused resources
+	};
+
+	struct Pass {
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<FrameGraphResource> reads;
+		std::vector<FrameGraphResource> writes;
+		bool sideEffect;
+		bool alive;
+	};
+
+	struct PooledTexture {
+		FrameGraphTextureDesc desc;
+		unsigned int texture;
+		unsigned int lastCompile; // the last compile a resource was given this texture in
+	};
+
+	static const unsigned int POOL_KEEP_COMPILES = 3;
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<unsigned int> order;
+	std::vector<PooledTexture> pool;
+	std::map<std::vector<unsigned int>, unsigned int> framebuffers;
+
+	unsigned int culledPasses = 0;
+	unsigned int aliasedResources = 0;
+	unsigned int compileCount = 0;
+
+	static bool isDepthFormat(GLenum format);
+	static bool hasStencil(GLenum format);
+	unsigned int createTexture(const FrameGraphTextureDesc& desc);
+	unsigned int framebufferFor(const std::vector<FrameGraphResource>& attachments, const std::string& name);
+
+	void sortPasses();
+	void cullPasses();
+	void assignTextures();
+	void evictUnusedTextures();
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "FrustumCulling.h"
+#include "Benchmark.h"
+
+#include <random>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#include "glm\glm\gtc\matrix_transform.hpp"
+
+void AABBList::add(const glm::vec3& min, const glm::vec3& max) {
+	// grows in steps of 8 so the SIMD loops never read past the end
+	if (count % 8 == 0) {
+		size_t padded = count + 8;
+		minX.resize(padded, 0.0f); minY.resize(padded, 0.0f); minZ.resize(padded, 0.0f);
+		// empty boxes with min > max are behind every plane
+		maxX.resize(padded, -1e30f); maxY.resize(padded, -1e30f); maxZ.resize(padded, -1e30f);
+		for (size_t i = count; i < padded; i++) {
+			minX[i] = minY[i] = minZ[i] = 1e30f;
+		}
+	}
+	set(count++, min, max);
+}
+
+void AABBList::set(unsigned int index, const glm::vec3& min, const glm::vec3& max) {
+	minX[index] = min.x; minY[index] = min.y; minZ[index] = min.z;
+	maxX[index] = max.x; maxY[index] = max.y; maxZ[index] = max.z;
+}
+
+void AABBList::clear() {
+	minX.clear(); minY.clear(); minZ.clear();
+	maxX.clear(); maxY.clear(); maxZ.clear();
+	count = 0;
+}
+
+Frustum FrustumCulling::extract(const glm::mat4& viewProj) {
+	// rows of the matrix, glm stores columns
+	glm::vec4 row[4];
+	for (int r = 0; r < 4; r++)
+		row[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+
+	Frustum frustum;
+	frustum.planes[0] = row[3] + row[0];
+	frustum.planes[1] = row[3] - row[0];
+	frustum.planes[2] = row[3] + row[1];
+	frustum.planes[3] = row[3] - row[1];
+	frustum.planes[4] = row[3] + row[2];
+	frustum.planes[5] = row[3] - row[2];
+
+	for (glm::vec4& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		plane = plane / length;
+	}
+	return frustum;
+}
+
+bool FrustumCulling::hasAVX2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+void FrustumCulling::cullScalar(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible) {
+	for (unsigned int i = 0; i < boxes.count; i++) {
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes) {
+			float x = plane.x > 0.0f ? boxes.maxX[i] : boxes.minX[i];
+			float y = plane.y > 0.0f ? boxes.maxY[i] : boxes.minY[i];
+			float z = plane.z > 0.0f ? boxes.maxZ[i] : boxes.minZ[i];
+			// summed in the same order as the SIMD kernels, so resultsMatch can compare them exactly
+			float distance = plane.x * x + plane.w;
+			distance += plane.y * y;
+			distance += plane.z * z;
+			if (distance < 0.0f) {
+				inside = false;
+				break;
+			}
+		}
+		if (inside)
+			visible.push_back(i);
+	}
+}
+
+// the corner choice depends only on the plane, so per plane it is just a choice between the min and max arrays
+void FrustumCulling::cullSSE(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible) {
+	const float* xs[6]; const float* ys[6]; const float* zs[6];
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		xs[p] = plane.x > 0.0f ? boxes.maxX.data() : boxes.minX.data();
+		ys[p] = plane.y > 0.0f ? boxes.maxY.data() : boxes.minY.data();
+		zs[p] = plane.z > 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+		nx[p] = _mm_set1_ps(plane.x);
+		ny[p] = _mm_set1_ps(plane.y);
+		nz[p] = _mm_set1_ps(plane.z);
+		d[p] = _mm_set1_ps(plane.w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned int i = 0; i < boxes.count; i += 4) {
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(nx[p], _mm_loadu_ps(xs[p] + i)), d[p]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(ny[p], _mm_loadu_ps(ys[p] + i)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(nz[p], _mm_loadu_ps(zs[p] + i)));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+
+		int mask = ~_mm_movemask_ps(outside) & 0xF;
+		while (mask) {
+			unsigned int lane = 0;
+			while (!(mask & (1 << lane)))
+				lane++;
+			mask &= mask - 1;
+			if (i + lane < boxes.count)
+				visible.push_back(i + lane);
+		}
+	}
+}
+
+TARGET_AVX2 void FrustumCulling::cullAVX2(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible) {
+	const float* xs[6]; const float* ys[6]; const float* zs[6];
+	__m256 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		xs[p] = plane.x > 0.0f ? boxes.maxX.data() : boxes.minX.data();
+		ys[p] = plane.y > 0.0f ? boxes.maxY.data() : boxes.minY.data();
+		zs[p] = plane.z > 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+		nx[p] = _mm256_set1_ps(plane.x);
+		ny[p] = _mm256_set1_ps(plane.y);
+		nz[p] = _mm256_set1_ps(plane.z);
+		d[p] = _mm256_set1_ps(plane.w);
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (unsigned int i = 0; i < boxes.count; i += 8) {
+		__m256 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(nx[p], _mm256_loadu_ps(xs[p] + i)), d[p]);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ny[p], _mm256_loadu_ps(ys[p] + i)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(nz[p], _mm256_loadu_ps(zs[p] + i)));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+		}
+
+		int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+		while (mask) {
+			unsigned int lane = 0;
+			while (!(mask & (1 << lane)))
+				lane++;
+			mask &= mask - 1;
+			if (i + lane < boxes.count)
+				visible.push_back(i + lane);
+		}
+	}
+}
+
+void FrustumCulling::cull(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible) {
+	static const bool avx2 = hasAVX2();
+	if (avx2)
+		cullAVX2(frustum, boxes, visible);
+	else
+		cullSSE(frustum, boxes, visible);
+}
+
+CullBenchmarkResult FrustumCulling::benchmark(unsigned int boxCount, unsigned int iterations) {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+	AABBList boxes;
+	for (unsigned int i = 0; i < boxCount; i++) {
+		glm::vec3 min(position(random), position(random), position(random));
+		boxes.add(min, min + glm::vec3(size(random), size(random), size(random)));
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 300.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum = extract(projection * view);
+
+	std::vector<unsigned int> visible;
+	visible.reserve(boxCount);
+
+	auto time = [&](void (*cullFunction)(const Frustum&, const AABBList&, std::vector<unsigned int>&)) {
+		return Benchmark::averageMs(iterations, [&]() {
+			visible.clear();
+			cullFunction(frustum, boxes, visible);
+		});
+	};
+
+	CullBenchmarkResult result;
+	result.boxCount = boxCount;
+
+	result.scalarMs = time(cullScalar);
+	std::vector<unsigned int> reference = visible;
+	result.visibleCount = (unsigned int)reference.size();
+
+	result.sseMs = time(cullSSE);
+	result.resultsMatch = visible == reference;
+
+	result.avx2Ms = -1.0;
+	if (hasAVX2()) {
+		result.avx2Ms = time(cullAVX2);
+		result.resultsMatch = result.resultsMatch && visible == reference;
+	}
+	return result;
+}
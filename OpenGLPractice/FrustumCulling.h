@@ -0,0 +1,51 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+
+// six planes as (normal, d) with normals pointing inside: left, right, bottom, top, near, far
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+// axis aligned boxes stored as structure of arrays, so SIMD code loads 4 or 8 boxes of one component at once.
+// the arrays are padded to a multiple of 8 with empty boxes, padding is never reported visible
+struct AABBList {
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+	unsigned int count = 0;
+
+	void add(const glm::vec3& min, const glm::vec3& max);
+	void set(unsigned int index, const glm::vec3& min, const glm::vec3& max);
+	void clear();
+};
+
+struct CullBenchmarkResult {
+	unsigned int boxCount;
+	unsigned int visibleCount;
+	double scalarMs;
+	double sseMs;
+	double avx2Ms;   // negative if the CPU has no AVX2
+	bool resultsMatch;
+};
+
+namespace FrustumCulling {
+	// Gribb/Hartmann plane extraction from projection * view, planes normalized
+	Frustum extract(const glm::mat4& viewProj);
+
+	bool hasAVX2();
+
+	// all of them append the indices of boxes that are inside or intersect the frustum to visible, in increasing order.
+	// a box is culled when its corner furthest along a plane normal is still behind that plane
+	void cullScalar(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible);
+	void cullSSE(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible);
+	void cullAVX2(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible);
+	// picks AVX2 when the CPU supports it, otherwise SSE
+	void cull(const Frustum& frustum, const AABBList& boxes, std::vector<unsigned int>& visible);
+
+	// culls boxCount random boxes from a fixed seed with every path, average time per cull over the iterations
+	CullBenchmarkResult benchmark(unsigned int boxCount, unsigned int iterations);
+}
+
+#endif
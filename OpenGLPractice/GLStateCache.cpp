@@ -0,0 +1,163 @@
+#include "GLStateCache.h"
+
+GLStateCache glState;
+
+GLStateCache::GLStateCache() : counters({ 0, 0 })
+{
+	invalidate();
+}
+
+// updates the shadow and counts the call. returns true if it has to reach the driver
+bool GLStateCache::changed(unsigned int& shadow, unsigned int value) {
+	if (shadow == value) {
+		counters.elided++;
+		return false;
+	}
+	shadow = value;
+	counters.issued++;
+	return true;
+}
+
+bool GLStateCache::changed(int& shadow, bool value) {
+	if (shadow == (int)value) {
+		counters.elided++;
+		return false;
+	}
+	shadow = (int)value;
+	counters.issued++;
+	return true;
+}
+
+void GLStateCache::useProgram(unsigned int program) {
+	if (changed(this->program, program))
+		glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(unsigned int VAO) {
+	if (changed(this->VAO, VAO))
+		glBindVertexArray(VAO);
+}
+
+void GLStateCache::activeTexture(unsigned int unit) {
+	if (changed(activeUnit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::bindTexture(unsigned int unit, unsigned int texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		activeTexture(unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		counters.issued++;
+		return;
+	}
+	if (textures[unit] == texture) {
+		counters.elided++;
+		return;
+	}
+	activeTexture(unit);
+	changed(textures[unit], texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLStateCache::bindTextureForEdit(unsigned int unit, unsigned int texture) {
+	activeTexture(unit);
+	bindTexture(unit, texture);
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+	if (changed(depthTest, enabled)) {
+		if (enabled)
+			glEnable(GL_DEPTH_TEST);
+		else
+			glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void GLStateCache::setDepthFunc(GLenum func) {
+	if (changed(depthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLStateCache::setDepthMask(bool write) {
+	if (changed(depthMask, write))
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::setColorMask(bool write) {
+	if (changed(colorMask, write)) {
+		GLboolean mask = write ? GL_TRUE : GL_FALSE;
+		glColorMask(mask, mask, mask, mask);
+	}
+}
+
+void GLStateCache::setBlend(bool enabled) {
+	if (changed(blend, enabled)) {
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+	}
+}
+
+void GLStateCache::setBlendFunc(GLenum src, GLenum dst) {
+	if (blendSrc == src && blendDst == dst) {
+		counters.elided++;
+		return;
+	}
+	blendSrc = src;
+	blendDst = dst;
+	counters.issued++;
+	glBlendFunc(src, dst);
+}
+
+void GLStateCache::setPolygonMode(GLenum mode) {
+	if (changed(polygonMode, mode))
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+GLenum GLStateCache::getPolygonMode() {
+	if (polygonMode == UNKNOWN) {
+		// front and back, setPolygonMode always sets both
+		GLint modes[2] = { GL_FILL, GL_FILL };
+		glGetIntegerv(GL_POLYGON_MODE, modes);
+		polygonMode = (GLenum)modes[0];
+	}
+	return polygonMode;
+}
+
+void GLStateCache::deleteProgram(unsigned int program) {
+	if (this->program == program)
+		this->program = UNKNOWN;
+	glDeleteProgram(program);
+}
+
+void GLStateCache::deleteVertexArray(unsigned int VAO) {
+	if (this->VAO == VAO)
+		this->VAO = UNKNOWN;
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void GLStateCache::deleteTexture(unsigned int texture) {
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		if (textures[unit] == texture)
+			textures[unit] = UNKNOWN;
+	}
+	glDeleteTextures(1, &texture);
+}
+
+void GLStateCache::invalidate() {
+	program = UNKNOWN;
+	VAO = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+		textures[unit] = UNKNOWN;
+
+	depthTest = -1;
+	depthMask = -1;
+	colorMask = -1;
+	blend = -1;
+	depthFunc = UNKNOWN;
+	blendSrc = UNKNOWN;
+	blendDst = UNKNOWN;
+	polygonMode = UNKNOWN;
+}
@@ -0,0 +1,77 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// shadows the GL state the renderer touches every frame and skips calls that would not change it.
+// everything that binds programs, VAOs or textures or flips depth/blend/polygon mode should go through glState,
+// otherwise the shadow copy goes stale. call invalidate() after handing the context to code that does not.
+class GLStateCache
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	struct Stats {
+		unsigned int issued;
+		unsigned int elided;
+	};
+
+	GLStateCache();
+
+	void useProgram(unsigned int program);
+	void bindVertexArray(unsigned int VAO);
+	void activeTexture(unsigned int unit);
+	// binds a GL_TEXTURE_2D texture to the given unit, only switching the active unit when the binding changes
+	void bindTexture(unsigned int unit, unsigned int texture);
+	// like bindTexture, but always leaves unit active, so the glTexImage2D or glTexParameteri calls after it reach texture
+	void bindTextureForEdit(unsigned int unit, unsigned int texture);
+
+	void setDepthTest(bool enabled);
+	void setDepthFunc(GLenum func);
+	void setDepthMask(bool write);
+	void setColorMask(bool write);
+	void setBlend(bool enabled);
+	void setBlendFunc(GLenum src, GLenum dst);
+	void setPolygonMode(GLenum mode);
+	// the mode set last, asked from GL when it is not known, so a pass can put it back afterwards
+	GLenum getPolygonMode();
+
+	// deletes the object and forgets it, so a recycled name is not mistaken for the still bound one
+	void deleteProgram(unsigned int program);
+	void deleteVertexArray(unsigned int VAO);
+	void deleteTexture(unsigned int texture);
+
+	// marks everything unknown, the next call of every kind is always issued
+	void invalidate();
+
+	const Stats& stats() const { return counters; }
+	void resetStats() { counters = {}; }
+
+private:
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+	unsigned int program;
+	unsigned int VAO;
+	unsigned int activeUnit;
+	unsigned int textures[MAX_TEXTURE_UNITS];
+
+	// -1 means unknown, otherwise 0 or 1
+	int depthTest;
+	int depthMask;
+	int colorMask;
+	int blend;
+	GLenum depthFunc;
+	GLenum blendSrc;
+	GLenum blendDst;
+	GLenum polygonMode;
+
+	Stats counters;
+
+	bool changed(unsigned int& shadow, unsigned int value);
+	bool changed(int& shadow, bool value);
+};
+
+// the cache for the one context this program creates
+extern GLStateCache glState;
+
+#endif
@@ -0,0 +1,261 @@
+#include "HiZCulling.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstddef>
+
+HiZCulling::HiZCulling(unsigned int VAO) : VAO(VAO), indirect(GLAD_GL_VERSION_4_4 != 0), occlusionEnabled(true),
+	reduceShader("hizReduce.vs", "hizReduce.fs"), cullShader("hizCull.vs", "hizCull.gs", nullptr, { "outModel" }),
+	instanceCount(0), boundsMin(0.0f), boundsMax(0.0f), frame(0), commandFrame(0), commandFirst(0), commandCount(0), drawBuffer(1), drawCount(0),
+	depthTexture(0), pyramid(0), width(0), height(0), levels(0), pyramidValid(false), pyramidViewProj(1.0f)
+{
+	glGenBuffers(1, &instanceVBO);
+	glGenBuffers(2, survivors);
+	glGenQueries(2, queries);
+	queryPending[0] = queryPending[1] = false;
+
+	// the cull pass reads every model matrix as one point, so the columns are per vertex here
+	glGenVertexArrays(1, &cullVAO);
+	glState.bindVertexArray(cullVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int column = 0; column < 4; column++) {
+		glVertexAttribPointer(column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(column);
+	}
+
+	// the reduction draws a full screen triangle from gl_VertexID, core profile still wants a VAO bound
+	glGenVertexArrays(1, &emptyVAO);
+	glState.bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the survivors feed the mesh VAO as per instance columns, which buffer is picked per draw
+	glState.bindVertexArray(VAO);
+	for (unsigned int column = 0; column < 4; column++) {
+		glEnableVertexAttribArray(2 + column);
+		glVertexAttribDivisor(2 + column, 1);
+	}
+	glState.bindVertexArray(0);
+
+	glGenFramebuffers(1, &reduceFBO);
+
+	indirectBuffer = 0;
+	if (indirect)
+		glGenBuffers(1, &indirectBuffer);
+
+	cullShader.use();
+	cullShader.setInt("hiZ", 0);
+	reduceShader.use();
+	reduceShader.setInt("source", 0);
+}
+
+void HiZCulling::setInstances(const std::vector<glm::mat4>& models, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	instanceCount = (GLsizei)models.size();
+	this->boundsMin = boundsMin;
+	this->boundsMax = boundsMax;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, models.size() * sizeof(glm::mat4), models.data(), GL_STATIC_DRAW);
+	for (unsigned int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, survivors[i]);
+		glBufferData(GL_ARRAY_BUFFER, models.size() * sizeof(glm::mat4), NULL, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// whatever the old queries counted no longer matches the buffers
+	queryPending[0] = queryPending[1] = false;
+	drawCount = 0;
+	commandFrame = 0;
+}
+
+void HiZCulling::invalidate() {
+	pyramidValid = false;
+	queryPending[0] = queryPending[1] = false;
+	drawCount = 0;
+	commandFrame = 0;
+}
+
+void HiZCulling::resize(int width, int height) {
+	this->width = width;
+	this->height = height;
+
+	if (!depthTexture) {
+		glGenTextures(1, &depthTexture);
+		glGenTextures(1, &pyramid);
+	}
+
+	glState.bindTextureForEdit(0, depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	// level 0 of the pyramid is already half the depth buffer
+	glState.bindTextureForEdit(0, pyramid);
+	levels = 0;
+	for (int w = std::max(1, width / 2), h = std::max(1, height / 2); ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+		glTexImage2D(GL_TEXTURE_2D, levels++, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, NULL);
+		if (w == 1 && h == 1)
+			break;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+void HiZCulling::buildPyramid(int width, int height, const glm::mat4& viewProj) {
+	if (width <= 0 || height <= 0)
+		return;
+	if (width != this->width || height != this->height)
+		resize(width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glState.bindTextureForEdit(0, depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+	// in line mode the full screen triangle would only write its edges
+	GLenum polygonMode = glState.getPolygonMode();
+	glState.setPolygonMode(GL_FILL);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, reduceFBO);
+	glState.setDepthTest(false);
+	reduceShader.use();
+	glState.bindVertexArray(emptyVAO);
+
+	// each level reads only the one above it, base and max level keep the written level out of the sampled range
+	for (int level = 0; level < levels; level++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, level);
+		int w = std::max(1, width >> (level + 1)), h = std::max(1, height >> (level + 1));
+		glViewport(0, 0, w, h);
+
+		if (level == 0) {
+			glState.bindTexture(0, depthTexture);
+		}
+		else {
+			glState.bindTextureForEdit(0, pyramid);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+		}
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	glState.bindTextureForEdit(0, pyramid);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glState.setDepthTest(true);
+	glState.setPolygonMode(polygonMode);
+
+	pyramidValid = true;
+	pyramidViewProj = viewProj;
+}
+
+bool HiZCulling::pollSurvivors() {
+	unsigned int pending = 1 - drawBuffer;
+	if (!queryPending[pending])
+		return true;
+
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(queries[pending], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	glGetQueryObjectuiv(queries[pending], GL_QUERY_RESULT, &drawCount);
+	queryPending[pending] = false;
+	drawBuffer = pending;
+	return true;
+}
+
+void HiZCulling::cull(const glm::mat4& viewProj) {
+	if (instanceCount == 0)
+		return;
+	// the indirect path reads its query on the gpu, so it can alternate blindly. without it the buffer being drawn is kept
+	// and the other one is only refilled once its last count has been picked up
+	if (!indirect && !pollSurvivors())
+		return;
+	unsigned int current = indirect ? frame % 2 : 1 - drawBuffer;
+
+	cullShader.use();
+	cullShader.setMat4("viewProj", viewProj);
+	cullShader.setMat4("occlusionViewProj", pyramidViewProj);
+	cullShader.setBool("occlusionValid", occlusionEnabled && pyramidValid);
+	cullShader.setVec3("boundsMin", boundsMin);
+	cullShader.setVec3("boundsMax", boundsMax);
+	cullShader.setInt("pyramidLevels", levels);
+	glState.bindTexture(0, pyramid);
+	glState.bindVertexArray(cullVAO);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, survivors[current]);
+	glBeginQuery(GL_PRIMITIVES_GENERATED, queries[current]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, instanceCount);
+	glEndTransformFeedback();
+	glEndQuery(GL_PRIMITIVES_GENERATED);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	queryPending[current] = true;
+	frame++;
+}
+
+void HiZCulling::draw(GLint first, GLsizei count) {
+	if (!indirect) {
+		if (drawCount == 0)
+			return;
+		glState.bindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, survivors[drawBuffer]);
+		for (unsigned int column = 0; column < 4; column++)
+			glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(first * sizeof(GLuint)), drawCount);
+		return;
+	}
+
+	// cull() already moved frame on, so the buffer it just wrote is the previous one
+	unsigned int source = (frame + 1) % 2;
+	if (!queryPending[source])
+		return;
+
+	glState.bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, survivors[source]);
+	for (unsigned int column = 0; column < 4; column++)
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	if (commandFrame != frame || commandFirst != first || commandCount != count) {
+		// the query result lands in instanceCount on the gpu, the cpu never waits for it
+		DrawElementsIndirectCommand command = { (GLuint)count, 0, (GLuint)first, 0, 0 };
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_QUERY_BUFFER, indirectBuffer);
+		glGetQueryObjectuiv(queries[source], GL_QUERY_RESULT, (GLuint*)offsetof(DrawElementsIndirectCommand, instanceCount));
+		glBindBuffer(GL_QUERY_BUFFER, 0);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+		commandFrame = frame;
+		commandFirst = first;
+		commandCount = count;
+	}
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void HiZCulling::discard() {
+	reduceShader.discard();
+	cullShader.discard();
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteBuffers(2, survivors);
+	glDeleteQueries(2, queries);
+	glState.deleteVertexArray(cullVAO);
+	glState.deleteVertexArray(emptyVAO);
+	glDeleteFramebuffers(1, &reduceFBO);
+	if (indirectBuffer)
+		glDeleteBuffers(1, &indirectBuffer);
+	if (depthTexture) {
+		glState.deleteTexture(depthTexture);
+		glState.deleteTexture(pyramid);
+	}
+}
\ No newline at end of file
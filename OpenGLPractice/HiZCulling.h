@@ -0,0 +1,87 @@
+#ifndef HIZ_CULLING_H
+#define HIZ_CULLING_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "shader.h"
+#include "BatchRenderer.h"
+
+// occlusion culling on the gpu against a hierarchical-z pyramid of the previous frame's depth.
+// after a frame is drawn its depth is copied and reduced into a mip chain of farthest depths. the next frame every instance
+// is tested as one point: the vertex shader checks its box against the frustum and the pyramid, a geometry shader
+// drops the hidden ones and transform feedback writes the model matrices of the rest into an instance buffer.
+// nothing is read back on the cpu:
+//  - with GL 4.4 the primitive count query is written straight into an indirect draw command
+//  - on GL 3.3 the survivors are drawn one frame late. a buffer is only drawn once its query reports the result available,
+//    until then the older survivors keep being drawn and culling waits instead of overwriting the pending buffer
+//
+// the occlusion test uses the matrix the pyramid was made with, so it only works for static instances
+class HiZCulling
+{
+public:
+	// VAO is the mesh to draw, the survivors are attached to its attributes 2 to 5 like the batch renderer does
+	HiZCulling(unsigned int VAO);
+
+	// every instance shares one box in model space
+	void setInstances(const std::vector<glm::mat4>& models, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	// copies the depth of the frame that was just drawn into the pyramid, call before swapping buffers
+	void buildPyramid(int width, int height, const glm::mat4& viewProj);
+	// tests all instances against this frame's frustum and the last pyramid
+	void cull(const glm::mat4& viewProj);
+	// forgets the pyramid and the survivors, call when culling is paused so it does not resume against a stale depth.
+	// nothing is drawn until the next cull, and that one only tests the frustum until a new pyramid is built
+	void invalidate();
+	// draws the indices [first, first + count) of the VAO's element buffer for every survivor, with whatever program and textures are bound
+	void draw(GLint first, GLsizei count);
+
+	void setOcclusionEnabled(bool enabled) { occlusionEnabled = enabled; }
+	bool isIndirect() const { return indirect; }
+
+	void discard();
+
+private:
+	unsigned int VAO;
+	bool indirect;
+	bool occlusionEnabled;
+
+	Shader reduceShader;
+	Shader cullShader;
+
+	unsigned int instanceVBO;
+	unsigned int cullVAO;
+	unsigned int emptyVAO;
+	GLsizei instanceCount;
+	glm::vec3 boundsMin, boundsMax;
+
+	unsigned int survivors[2];
+	unsigned int queries[2];
+	bool queryPending[2];
+	unsigned int frame;
+
+	// GL 4.4, the command is written once per frame however often draw() runs
+	unsigned int indirectBuffer;
+	unsigned int commandFrame;
+	GLint commandFirst;
+	GLsizei commandCount;
+
+	// GL 3.3, the newest survivors whose count is known
+	unsigned int drawBuffer;
+	GLuint drawCount;
+
+	unsigned int depthTexture;
+	unsigned int pyramid;
+	unsigned int reduceFBO;
+	int width, height;
+	int levels;
+	bool pyramidValid;
+	glm::mat4 pyramidViewProj;
+
+	void resize(int width, int height);
+	// takes over the pending buffer if its count arrived, returns false while it is still being worked on
+	bool pollSurvivors();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "InputAccumulator.h"
+
+void InputAccumulator::cursorMoved(double posX, double posY) {
+	if (firstCursor) {
+		lastX = posX;
+		lastY = posY;
+		firstCursor = false;
+	}
+
+	cursorX += posX - lastX;
+	cursorY += lastY - posY;
+	lastX = posX;
+	lastY = posY;
+	cursorEvents++;
+}
+
+void InputAccumulator::scrolled(double offset) {
+	scroll += offset;
+}
+
+// GLFW_KEY_UNKNOWN is -1, keys outside the table are dropped
+void InputAccumulator::keyChanged(int key, int action) {
+	if (key < 0 || key > GLFW_KEY_LAST)
+		return;
+
+	if (action == GLFW_PRESS) {
+		held.set(key);
+		pressed.set(key);
+	}
+	else if (action == GLFW_RELEASE) {
+		held.reset(key);
+	}
+}
+
+InputFrame InputAccumulator::takeFrame() {
+	InputFrame frame;
+	frame.cursorX = (float)cursorX;
+	frame.cursorY = (float)cursorY;
+	frame.scroll = (float)scroll;
+	frame.cursorEvents = cursorEvents;
+	frame.down = held;
+	frame.pressed = pressed;
+
+	cursorX = cursorY = scroll = 0.0;
+	cursorEvents = 0;
+	pressed.reset();
+	return frame;
+}
@@ -0,0 +1,54 @@
+#ifndef INPUT_ACCUMULATOR_H
+#define INPUT_ACCUMULATOR_H
+
+#include <GLFW/glfw3.h>
+
+#include <bitset>
+
+typedef std::bitset<GLFW_KEY_LAST + 1> KeySet;
+
+// everything the callbacks saw since the frame before
+struct InputFrame {
+	// cursor movement in pixels, y already flipped so moving the mouse up is positive
+	float cursorX = 0.0f;
+	float cursorY = 0.0f;
+	float scroll = 0.0f;
+	// how many cursor events were folded into cursorX/Y
+	unsigned int cursorEvents = 0;
+
+	KeySet down;
+	// keys that went down during the frame, also the ones already released again before it ended
+	KeySet pressed;
+
+	bool isDown(int key) const { return key >= 0 && key <= GLFW_KEY_LAST && down[key]; }
+	bool wasPressed(int key) const { return key >= 0 && key <= GLFW_KEY_LAST && pressed[key]; }
+	bool hasLook() const { return cursorX != 0.0f || cursorY != 0.0f; }
+};
+
+// the glfw callbacks only add into this, and the main loop takes one snapshot per frame and applies it once.
+// a mouse polling at 1000hz sends many cursor events per frame, and the camera is still only turned once
+class InputAccumulator
+{
+public:
+	void cursorMoved(double posX, double posY);
+	void scrolled(double offset);
+	void keyChanged(int key, int action);
+
+	// the next cursor event only sets the start position, for when the cursor jumped (captured, window refocused)
+	void resetCursor() { firstCursor = true; }
+
+	// hands out what was collected since the last call and starts a new frame. held keys carry over
+	InputFrame takeFrame();
+
+private:
+	// summed in double, the positions glfw reports grow without bound while the cursor is captured
+	double cursorX = 0.0, cursorY = 0.0, scroll = 0.0;
+	unsigned int cursorEvents = 0;
+	double lastX = 0.0, lastY = 0.0;
+	bool firstCursor = true;
+
+	KeySet held;
+	KeySet pressed;
+};
+
+#endif
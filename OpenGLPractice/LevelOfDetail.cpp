@@ -0,0 +1,143 @@
+#include "LevelOfDetail.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+LODSelector::LODSelector(float pixelTolerance, float hysteresis) : pixelTolerance(pixelTolerance), hysteresis(hysteresis), cameraPosition(0.0f), projectionScale(1.0f)
+{
+}
+
+void LODSelector::setView(const glm::vec3& cameraPosition, float fovY, int viewportHeight) {
+	this->cameraPosition = cameraPosition;
+	// the view spans 2 * d * tan(fov / 2) world units over viewportHeight pixels at distance d
+	projectionScale = viewportHeight / (2.0f * std::tan(glm::radians(fovY) * 0.5f));
+}
+
+float LODSelector::pixelsPerUnit(float distance) const {
+	return projectionScale / std::max(distance, 1e-3f);
+}
+
+unsigned int LODSelector::select(const LODMesh& mesh, const glm::vec3& center, float scale, unsigned int current) const {
+	if (mesh.levels.empty())
+		return 0;
+
+	// the nearest point of the bounding sphere is where the error would show the most
+	float distance = glm::length(center - cameraPosition) - mesh.radius * scale;
+	float pixels = pixelsPerUnit(distance) * scale;
+	auto errorPixels = [&](unsigned int level) { return mesh.levels[level].error * pixels; };
+
+	unsigned int level = std::min(current, (unsigned int)mesh.levels.size() - 1);
+	if (errorPixels(level) > pixelTolerance * (1.0f + hysteresis)) {
+		while (level > 0 && errorPixels(level) > pixelTolerance)
+			level--;
+	}
+	else {
+		while (level + 1 < mesh.levels.size() && errorPixels(level + 1) <= pixelTolerance * (1.0f - hysteresis))
+			level++;
+	}
+	return level;
+}
+
+LODMesh LevelOfDetail::appendSphere(std::vector<float>& vertices, const std::vector<unsigned int>& segments) {
+	const float PI = 3.14159265358979f;
+	const float radius = 0.5f;
+
+	LODMesh mesh;
+	mesh.radius = radius;
+
+	for (unsigned int slices : segments) {
+		unsigned int stacks = std::max(2u, slices / 2);
+
+		auto vertex = [&](unsigned int slice, unsigned int stack) {
+			float u = (float)slice / slices, v = (float)stack / stacks;
+			float theta = u * 2.0f * PI, phi = v * PI;
+			vertices.push_back(radius * std::sin(phi) * std::cos(theta));
+			vertices.push_back(radius * std::cos(phi));
+			vertices.push_back(radius * std::sin(phi) * std::sin(theta));
+			vertices.push_back(u);
+			vertices.push_back(1.0f - v);
+		};
+
+		LODLevel level;
+		level.first = (GLint)(vertices.size() / 5);
+		for (unsigned int stack = 0; stack < stacks; stack++) {
+			for (unsigned int slice = 0; slice < slices; slice++) {
+				// the rows touching a pole are fans, the quad would have one side of zero length
+				if (stack != 0) {
+					vertex(slice, stack); vertex(slice + 1, stack); vertex(slice + 1, stack + 1);
+				}
+				if (stack != stacks - 1) {
+					vertex(slice, stack); vertex(slice + 1, stack + 1); vertex(slice, stack + 1);
+				}
+			}
+		}
+		level.count = (GLsizei)(vertices.size() / 5) - level.first;
+		// sagitta of one segment, the furthest a flat facet gets from the sphere
+		level.error = radius * (1.0f - std::cos(PI / slices));
+		mesh.levels.push_back(level);
+	}
+	return mesh;
+}
+
+LODBenchmarkResult LevelOfDetail::benchmark(unsigned int objectCount) {
+	std::vector<float> vertices;
+	LODMesh sphere = appendSphere(vertices, { 64, 32, 16, 8, 4 });
+
+	// a field of spheres of different sizes around the origin
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.5f, 3.0f);
+	std::vector<glm::vec3> centers(objectCount);
+	std::vector<float> scales(objectCount);
+	for (unsigned int i = 0; i < objectCount; i++) {
+		centers[i] = glm::vec3(position(random), position(random), position(random));
+		scales[i] = size(random);
+	}
+
+	LODBenchmarkResult result;
+	result.objectCount = objectCount;
+
+	LODSelector selector;
+	std::vector<unsigned int> levels(objectCount, 0);
+	for (float distance : { 60.0f, 100.0f, 200.0f, 400.0f, 800.0f, 1600.0f }) {
+		selector.setView(glm::vec3(0.0f, 0.0f, distance), 45.0f, 600);
+
+		LODBenchmarkSample sample;
+		sample.distance = distance;
+		sample.fullTriangles = (unsigned long long)objectCount * (sphere.levels[0].count / 3);
+		sample.lodTriangles = 0;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < objectCount; i++) {
+			levels[i] = selector.select(sphere, centers[i], scales[i], levels[i]);
+			sample.lodTriangles += sphere.levels[levels[i]].count / 3;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		sample.selectMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+		result.samples.push_back(sample);
+	}
+
+	// the camera wobbling by half a percent is enough to flip objects sitting on a threshold without the band
+	auto countSwitches = [&](float hysteresis) {
+		selector.setHysteresis(hysteresis);
+		std::fill(levels.begin(), levels.end(), 0);
+		unsigned int switches = 0;
+		for (unsigned int frame = 0; frame < 100; frame++) {
+			float distance = 200.0f * (1.0f + 0.005f * std::sin(frame * 0.5f));
+			selector.setView(glm::vec3(0.0f, 0.0f, distance), 45.0f, 600);
+			for (unsigned int i = 0; i < objectCount; i++) {
+				unsigned int level = selector.select(sphere, centers[i], scales[i], levels[i]);
+				if (frame > 0 && level != levels[i])
+					switches++;
+				levels[i] = level;
+			}
+		}
+		return switches;
+	};
+	result.switchesWithHysteresis = countSwitches(0.2f);
+	result.switchesWithoutHysteresis = countSwitches(0.0f);
+	return result;
+}
@@ -0,0 +1,71 @@
+#ifndef LEVEL_OF_DETAIL_H
+#define LEVEL_OF_DETAIL_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+
+// one detail level, a range of the shared vertex buffer drawn with glDrawArrays, or of the index buffer once main.cpp has optimized it
+struct LODLevel {
+	GLint first;
+	GLsizei count;
+	// largest distance between this level and the real surface, in model units
+	float error;
+};
+
+// levels go from finest to coarsest
+struct LODMesh {
+	std::vector<LODLevel> levels;
+	float radius;
+};
+
+// picks the coarsest level whose error projects to at most pixelTolerance pixels.
+// the hysteresis band keeps an object on its level until the error is clearly outside the tolerance,
+// so one sitting near a threshold does not flip every frame
+class LODSelector
+{
+public:
+	LODSelector(float pixelTolerance = 1.0f, float hysteresis = 0.2f);
+
+	// fovY in degrees, which is what Camera::Zoom holds
+	void setView(const glm::vec3& cameraPosition, float fovY, int viewportHeight);
+	// pixels covered by one world unit at that distance from the camera
+	float pixelsPerUnit(float distance) const;
+
+	// current is the level the object had last frame
+	unsigned int select(const LODMesh& mesh, const glm::vec3& center, float scale, unsigned int current) const;
+
+	void setHysteresis(float hysteresis) { this->hysteresis = hysteresis; }
+
+private:
+	float pixelTolerance;
+	float hysteresis;
+	glm::vec3 cameraPosition;
+	float projectionScale;
+};
+
+struct LODBenchmarkSample {
+	float distance;
+	unsigned long long fullTriangles;
+	unsigned long long lodTriangles;
+	double selectMs;
+};
+
+struct LODBenchmarkResult {
+	unsigned int objectCount;
+	std::vector<LODBenchmarkSample> samples;
+	// level changes while the camera drifts back and forth around one distance
+	unsigned int switchesWithHysteresis;
+	unsigned int switchesWithoutHysteresis;
+};
+
+namespace LevelOfDetail {
+	// appends a uv sphere of radius 0.5 as position + texture coordinate triangles, one level per entry of segments
+	LODMesh appendSphere(std::vector<float>& vertices, const std::vector<unsigned int>& segments);
+
+	// triangles submitted for a randomly placed field of spheres, seen from further and further away
+	LODBenchmarkResult benchmark(unsigned int objectCount);
+}
+
+#endif
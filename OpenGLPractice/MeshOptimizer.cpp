@@ -0,0 +1,241 @@
+#include "MeshOptimizer.h"
+#include "Benchmark.h"
+#include "LevelOfDetail.h"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	// hashes and compares vertices by their bits, straight out of the source array
+	struct VertexHash {
+		unsigned int floatsPerVertex;
+
+		size_t operator()(const float* vertex) const {
+			uint32_t hash = 2166136261u;
+			for (unsigned int i = 0; i < floatsPerVertex; i++) {
+				uint32_t bits;
+				std::memcpy(&bits, &vertex[i], sizeof(bits));
+				hash = (hash ^ bits) * 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	struct VertexEqual {
+		unsigned int floatsPerVertex;
+
+		bool operator()(const float* a, const float* b) const {
+			return std::memcmp(a, b, floatsPerVertex * sizeof(float)) == 0;
+		}
+	};
+}
+
+IndexedMesh MeshOptimizer::weld(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex) {
+	IndexedMesh mesh;
+	mesh.floatsPerVertex = floatsPerVertex;
+	mesh.indices.reserve(vertexCount);
+
+	std::unordered_map<const float*, unsigned int, VertexHash, VertexEqual> unique(vertexCount, VertexHash{ floatsPerVertex }, VertexEqual{ floatsPerVertex });
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		const float* vertex = vertices + (size_t)v * floatsPerVertex;
+		auto found = unique.find(vertex);
+
+		if (found != unique.end()) {
+			mesh.indices.push_back(found->second);
+		}
+		else {
+			unsigned int index = mesh.vertexCount();
+			unique.emplace(vertex, index);
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + floatsPerVertex);
+			mesh.indices.push_back(index);
+		}
+	}
+	return mesh;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize) {
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// triangles around every vertex, as one flat array with per vertex offsets
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (unsigned int index : indices)
+		live[index]++;
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		for (unsigned int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int time = cacheSize + 1;
+	unsigned int cursor = 1;
+	int fanning = 0;
+
+	while (fanning >= 0) {
+		candidates.clear();
+
+		// emits every remaining triangle around the fanning vertex
+		for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = true;
+		}
+
+		// next fanning vertex: the candidate still in cache that stays there longest, with triangles left to emit
+		// candidates that would drop out of the cache keep priority 0 and never qualify, those go to the dead-end stack below
+		int next = -1;
+		int best = 0;
+		for (unsigned int v : candidates) {
+			if (live[v] == 0)
+				continue;
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = (int)(time - cacheTime[v]);
+			if (priority > best) {
+				best = priority;
+				next = (int)v;
+			}
+		}
+
+		// otherwise fall back on recently touched vertices, then on a scan through the input order
+		while (next == -1 && !deadEnd.empty()) {
+			unsigned int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				next = (int)v;
+		}
+		while (next == -1 && cursor < vertexCount) {
+			if (live[cursor] > 0)
+				next = (int)cursor;
+			cursor++;
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(IndexedMesh& mesh) {
+	const unsigned int UNUSED = 0xFFFFFFFF;
+	unsigned int stride = mesh.floatsPerVertex;
+
+	std::vector<unsigned int> remap(mesh.vertexCount(), UNUSED);
+	std::vector<float> reordered;
+	reordered.reserve(mesh.vertices.size());
+
+	for (unsigned int& index : mesh.indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = (unsigned int)(reordered.size() / stride);
+			const float* vertex = &mesh.vertices[(size_t)index * stride];
+			reordered.insert(reordered.end(), vertex, vertex + stride);
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(reordered);
+}
+
+CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize) {
+	// a vertex is in the FIFO if it was pushed less than cacheSize misses ago
+	std::vector<unsigned int> pushedAt(vertexCount, 0);
+	unsigned int misses = 0;
+
+	for (unsigned int index : indices) {
+		if (pushedAt[index] == 0 || misses - pushedAt[index] + 1 > cacheSize) {
+			misses++;
+			pushedAt[index] = misses;
+		}
+	}
+
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+	CacheStats stats;
+	stats.ACMR = triangleCount ? (float)misses / (float)triangleCount : 0.0f;
+	stats.ATVR = vertexCount ? (float)misses / (float)vertexCount : 0.0f;
+	return stats;
+}
+
+IndexedMesh MeshOptimizer::optimize(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex, MeshOptimizeReport* report) {
+	IndexedMesh mesh = weld(vertices, vertexCount, floatsPerVertex);
+
+	if (report) {
+		// the unindexed input transforms every vertex it submits
+		report->verticesBefore = vertexCount;
+		report->before.ACMR = vertexCount ? 3.0f : 0.0f;
+		report->before.ATVR = mesh.vertexCount() ? (float)vertexCount / (float)mesh.vertexCount() : 0.0f;
+		report->welded = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+	}
+
+	optimizeVertexCache(mesh.indices, mesh.vertexCount());
+	optimizeVertexFetch(mesh);
+
+	if (report) {
+		report->verticesAfter = mesh.vertexCount();
+		report->after = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+	}
+	return mesh;
+}
+
+unsigned int MeshOptimizer::appendOptimized(IndexedMesh& shared, const float* vertices, unsigned int count, MeshOptimizeReport* report) {
+	IndexedMesh mesh = optimize(vertices, count, shared.floatsPerVertex, report);
+
+	unsigned int baseVertex = shared.vertexCount();
+	unsigned int firstIndex = (unsigned int)shared.indices.size();
+	shared.vertices.insert(shared.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+	for (unsigned int index : mesh.indices)
+		shared.indices.push_back(baseVertex + index);
+	return firstIndex;
+}
+
+MeshBenchmarkResult MeshOptimizer::benchmark(unsigned int gridSize) {
+	MeshBenchmarkResult result;
+	result.gridSize = gridSize;
+
+	// position and texture coordinate, two triangles per cell
+	std::vector<float> grid;
+	auto corner = [&grid, gridSize](unsigned int x, unsigned int z) {
+		float u = (float)x / gridSize, v = (float)z / gridSize;
+		grid.insert(grid.end(), { u - 0.5f, 0.0f, v - 0.5f, u, v });
+	};
+	for (unsigned int z = 0; z < gridSize; z++) {
+		for (unsigned int x = 0; x < gridSize; x++) {
+			corner(x, z); corner(x + 1, z); corner(x + 1, z + 1);
+			corner(x, z); corner(x + 1, z + 1); corner(x, z + 1);
+		}
+	}
+	unsigned int gridVertices = (unsigned int)(grid.size() / 5);
+	result.gridOptimizeMs = Benchmark::averageMs(1, [&]() { optimize(grid.data(), gridVertices, 5, &result.grid); });
+
+	std::vector<float> sphere;
+	result.sphereSegments = 48;
+	LODMesh sphereMesh = LevelOfDetail::appendSphere(sphere, { result.sphereSegments });
+	optimize(sphere.data(), (unsigned int)sphereMesh.levels[0].count, 5, &result.sphere);
+	return result;
+}
@@ -0,0 +1,69 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+// an interleaved vertex array plus the triangle list indexing into it
+struct IndexedMesh {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int floatsPerVertex;
+
+	unsigned int vertexCount() const { return (unsigned int)(vertices.size() / floatsPerVertex); }
+};
+
+// post-transform vertex cache numbers for a triangle list.
+// ACMR is transformed vertices per triangle (0.5 is the best a regular grid can do, 3 means no reuse at all),
+// ATVR is transformed vertices per unique vertex (1 is ideal)
+struct CacheStats {
+	float ACMR;
+	float ATVR;
+};
+
+struct MeshOptimizeReport {
+	unsigned int verticesBefore;
+	unsigned int verticesAfter;
+	CacheStats before;
+	// indexed, still in the input triangle order
+	CacheStats welded;
+	CacheStats after;
+};
+
+struct MeshBenchmarkResult {
+	unsigned int gridSize;
+	MeshOptimizeReport grid;
+	double gridOptimizeMs;
+	unsigned int sphereSegments;
+	MeshOptimizeReport sphere;
+};
+
+namespace MeshOptimizer {
+	// default size of the simulated FIFO cache, the same size Tipsify optimizes for
+	const unsigned int CACHE_SIZE = 16;
+
+	// merges bitwise identical vertices of a non-indexed triangle list and builds the index buffer for them
+	IndexedMesh weld(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex);
+
+	// reorders triangles for post-transform cache hits (Tipsify, Sander et al. 2007). linear in the number of triangles
+	void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+	// reorders vertices into the order the indices first reference them, so fetching walks memory forward.
+	// vertices no triangle uses are dropped
+	void optimizeVertexFetch(IndexedMesh& mesh);
+
+	// simulates a FIFO cache of the given size over the index buffer
+	CacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+	// weld, cache order and fetch order in one go, reporting the cache numbers of the unindexed input against the result
+	IndexedMesh optimize(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex, MeshOptimizeReport* report = nullptr);
+
+	// optimizes count vertices of a non-indexed triangle list and appends them to shared, which sets floatsPerVertex.
+	// the appended indices already point at where the vertices landed. returns the position of the first one
+	unsigned int appendOptimized(IndexedMesh& shared, const float* vertices, unsigned int count, MeshOptimizeReport* report = nullptr);
+
+	// a gridSize by gridSize quad grid written out row by row, the way an unindexed export comes in,
+	// and the finest sphere main.cpp draws, each optimized and measured
+	MeshBenchmarkResult benchmark(unsigned int gridSize);
+}
+
+#endif
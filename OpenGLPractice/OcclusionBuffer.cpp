@@ -0,0 +1,229 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace {
+	// vertices closer than this in clip w are treated as crossing the near plane
+	const float NEAR_W = 1e-3f;
+
+	// the faces go in as quads, split into triangles the pixels along each diagonal would be fully inside neither half
+	const unsigned int BOX_FACES[6][4] = {
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 },
+		{ 0, 4, 5, 1 }, { 2, 3, 7, 6 },
+		{ 0, 2, 6, 4 }, { 1, 5, 7, 3 }
+	};
+
+	void boxCorners(const glm::vec3& min, const glm::vec3& max, glm::vec3 corners[8]) {
+		for (int i = 0; i < 8; i++)
+			corners[i] = glm::vec3(i & 4 ? max.x : min.x, i & 2 ? max.y : min.y, i & 1 ? max.z : min.z);
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) : viewProj(1.0f), counters({ 0, 0, 0 })
+{
+	this->width = (width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+	this->height = (height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+	tilesX = this->width / TILE_SIZE;
+	tilesY = this->height / TILE_SIZE;
+	depth.assign((size_t)this->width * this->height, 1.0f);
+	tileMax.assign((size_t)tilesX * tilesY, 1.0f);
+}
+
+void OcclusionBuffer::begin(const glm::mat4& viewProj) {
+	this->viewProj = viewProj;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(tileMax.begin(), tileMax.end(), 1.0f);
+	counters = { 0, 0, 0 };
+}
+
+void OcclusionBuffer::renderOccluderBox(const glm::vec3& min, const glm::vec3& max) {
+	glm::vec3 corners[8];
+	boxCorners(min, max, corners);
+
+	glm::vec4 clip[8];
+	for (int i = 0; i < 8; i++)
+		clip[i] = viewProj * glm::vec4(corners[i], 1.0f);
+
+	for (const unsigned int* face : BOX_FACES) {
+		glm::vec4 quad[4] = { clip[face[0]], clip[face[1]], clip[face[2]], clip[face[3]] };
+		// not clipping is conservative, the face just does not occlude anything
+		if (quad[0].w < NEAR_W || quad[1].w < NEAR_W || quad[2].w < NEAR_W || quad[3].w < NEAR_W)
+			continue;
+		rasterizePolygon(quad, 4);
+	}
+}
+
+void OcclusionBuffer::renderOccluder(const glm::vec3* vertices, const unsigned int* indices, unsigned int indexCount, const glm::mat4& model) {
+	glm::mat4 transform = viewProj * model;
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3) {
+		glm::vec4 triangle[3] = {
+			transform * glm::vec4(vertices[indices[i]], 1.0f),
+			transform * glm::vec4(vertices[indices[i + 1]], 1.0f),
+			transform * glm::vec4(vertices[indices[i + 2]], 1.0f)
+		};
+
+		if (triangle[0].w < NEAR_W || triangle[1].w < NEAR_W || triangle[2].w < NEAR_W)
+			continue;
+		rasterizePolygon(triangle, 3);
+	}
+}
+
+// edge functions and depth are planes in screen space, evaluated at the pixel centres of four pixels per step.
+// the edges are pulled in by half a pixel's extent along their normal, so a pixel passes only when all of it is inside,
+// and the depth is pushed back to the farthest corner of the pixel. an occluder covering just the centre of a pixel
+// would otherwise hide what shows through the rest of it.
+// both windings are drawn, back faces are always behind front faces so keeping the nearest depth sorts it out
+void OcclusionBuffer::rasterizePolygon(const glm::vec4* clip, int count) {
+	glm::vec3 v[4];
+	for (int i = 0; i < count; i++) {
+		float inverseW = 1.0f / clip[i].w;
+		v[i] = glm::vec3((clip[i].x * inverseW * 0.5f + 0.5f) * width,
+			(clip[i].y * inverseW * 0.5f + 0.5f) * height,
+			clip[i].z * inverseW * 0.5f + 0.5f);
+	}
+
+	// a planar polygon keeps one winding and one depth plane on screen, the first three corners give both
+	float det = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+	if (std::fabs(det) < 1e-8f)
+		return;
+	if (det < 0.0f) {
+		std::reverse(v, v + count);
+		det = -det;
+	}
+
+	float lowX = v[0].x, highX = v[0].x, lowY = v[0].y, highY = v[0].y;
+	for (int i = 1; i < count; i++) {
+		lowX = std::min(lowX, v[i].x);
+		highX = std::max(highX, v[i].x);
+		lowY = std::min(lowY, v[i].y);
+		highY = std::max(highY, v[i].y);
+	}
+	int minX = std::max(0, (int)std::floor(lowX));
+	int maxX = std::min(width - 1, (int)std::ceil(highX));
+	int minY = std::max(0, (int)std::floor(lowY));
+	int maxY = std::min(height - 1, (int)std::ceil(highY));
+	if (minX > maxX || minY > maxY)
+		return;
+	minX &= ~3;
+
+	counters.occluderTriangles += count - 2;
+
+	// E(p) = A * x + B * y + C, positive inside for counter clockwise edges. a triangle repeats its first edge as the fourth
+	float A[4], B[4], C[4];
+	for (int e = 0; e < 4; e++) {
+		const glm::vec3& a = v[e % count];
+		const glm::vec3& b = v[(e + 1) % count];
+		A[e] = -(b.y - a.y);
+		B[e] = b.x - a.x;
+		C[e] = -A[e] * a.x - B[e] * a.y - 0.5f * (std::fabs(A[e]) + std::fabs(B[e]));
+	}
+
+	float dz1 = v[1].z - v[0].z, dz2 = v[2].z - v[0].z;
+	float zA = (dz1 * (v[2].y - v[0].y) - dz2 * (v[1].y - v[0].y)) / det;
+	float zB = (dz2 * (v[1].x - v[0].x) - dz1 * (v[2].x - v[0].x)) / det;
+	float zC = v[0].z - zA * v[0].x - zB * v[0].y + 0.5f * (std::fabs(zA) + std::fabs(zB));
+
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 edgeA[4], zStepA = _mm_set1_ps(zA);
+	for (int e = 0; e < 4; e++)
+		edgeA[e] = _mm_set1_ps(A[e]);
+
+	for (int y = minY; y <= maxY; y++) {
+		float centerY = y + 0.5f;
+		__m128 edgeRow[4];
+		for (int e = 0; e < 4; e++)
+			edgeRow[e] = _mm_set1_ps(B[e] * centerY + C[e]);
+		__m128 zRow = _mm_set1_ps(zB * centerY + zC);
+
+		float* row = &depth[(size_t)y * width];
+		for (int x = minX; x <= maxX; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), edgeRow[0]), zero);
+			for (int e = 1; e < 4; e++)
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[e], px), edgeRow[e]), zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(zStepA, px), zRow);
+			__m128 old = _mm_loadu_ps(row + x);
+			__m128 nearest = _mm_min_ps(old, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+		}
+	}
+}
+
+void OcclusionBuffer::finish() {
+	for (int ty = 0; ty < tilesY; ty++) {
+		for (int tx = 0; tx < tilesX; tx++) {
+			__m128 farthest = _mm_setzero_ps();
+			for (int y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; y++) {
+				const float* row = &depth[(size_t)y * width + tx * TILE_SIZE];
+				farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+			}
+			float lanes[4];
+			_mm_storeu_ps(lanes, farthest);
+			tileMax[(size_t)ty * tilesX + tx] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+		}
+	}
+}
+
+// visible as soon as one covered pixel has occluder depth at or behind the nearest point of the box
+bool OcclusionBuffer::isVisible(const glm::vec3& min, const glm::vec3& max) {
+	counters.tested++;
+
+	glm::vec3 corners[8];
+	boxCorners(min, max, corners);
+
+	float screenMinX = 1e30f, screenMinY = 1e30f, screenMaxX = -1e30f, screenMaxY = -1e30f, nearestZ = 1.0f;
+	for (const glm::vec3& corner : corners) {
+		glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+		if (clip.w < NEAR_W)
+			return true;
+		float inverseW = 1.0f / clip.w;
+		float sx = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float sy = (clip.y * inverseW * 0.5f + 0.5f) * height;
+		screenMinX = std::min(screenMinX, sx);
+		screenMaxX = std::max(screenMaxX, sx);
+		screenMinY = std::min(screenMinY, sy);
+		screenMaxY = std::max(screenMaxY, sy);
+		nearestZ = std::min(nearestZ, clip.z * inverseW * 0.5f + 0.5f);
+	}
+
+	int minX = std::max(0, (int)std::floor(screenMinX));
+	int maxX = std::min(width - 1, (int)std::ceil(screenMaxX));
+	int minY = std::max(0, (int)std::floor(screenMinY));
+	int maxY = std::min(height - 1, (int)std::ceil(screenMaxY));
+	// off screen, the frustum cull decides about these
+	if (minX > maxX || minY > maxY)
+		return true;
+
+	__m128 boxZ = _mm_set1_ps(nearestZ);
+	for (int ty = minY / TILE_SIZE; ty <= maxY / TILE_SIZE; ty++) {
+		for (int tx = minX / TILE_SIZE; tx <= maxX / TILE_SIZE; tx++) {
+			if (tileMax[(size_t)ty * tilesX + tx] < nearestZ)
+				continue;
+
+			int x0 = std::max(minX, tx * TILE_SIZE), x1 = std::min(maxX, tx * TILE_SIZE + TILE_SIZE - 1);
+			int y0 = std::max(minY, ty * TILE_SIZE), y1 = std::min(maxY, ty * TILE_SIZE + TILE_SIZE - 1);
+			for (int y = y0; y <= y1; y++) {
+				const float* row = &depth[(size_t)y * width];
+				int x = x0;
+				for (; x + 3 <= x1; x += 4) {
+					if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxZ)))
+						return true;
+				}
+				for (; x <= x1; x++) {
+					if (row[x] >= nearestZ)
+						return true;
+				}
+			}
+		}
+	}
+
+	counters.occluded++;
+	return false;
+}
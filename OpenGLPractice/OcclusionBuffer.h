@@ -0,0 +1,54 @@
+#ifndef OCCLUSION_BUFFER_H
+#define OCCLUSION_BUFFER_H
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+
+// low resolution depth buffer rasterized on the CPU, for throwing away hidden objects before they are submitted.
+// a few large occluders are rasterized into it with SSE (four pixels per step), then the farthest depth of every 8x8 tile
+// is kept as a second, coarse level. bounds are tested against the coarse level first and only go down to pixels
+// where a tile does not settle it.
+//
+// everything errs on the side of visible: occluders only write pixels they cover entirely, with the farthest depth they
+// reach inside the pixel, occluder faces crossing the near plane are skipped, and tested boxes crossing it are always
+// reported visible
+class OcclusionBuffer
+{
+public:
+	static const int TILE_SIZE = 8;
+
+	struct Stats {
+		unsigned int occluderTriangles;
+		unsigned int tested;
+		unsigned int occluded;
+	};
+
+	// width and height are rounded up to multiples of TILE_SIZE
+	OcclusionBuffer(int width = 320, int height = 192);
+
+	// clears to the far plane and sets the matrix used by the following occluders and tests
+	void begin(const glm::mat4& viewProj);
+	void renderOccluderBox(const glm::vec3& min, const glm::vec3& max);
+	void renderOccluder(const glm::vec3* vertices, const unsigned int* indices, unsigned int indexCount, const glm::mat4& model);
+	// builds the tile level, call after the last occluder and before testing
+	void finish();
+
+	bool isVisible(const glm::vec3& min, const glm::vec3& max);
+
+	const Stats& stats() const { return counters; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+private:
+	int width, height;
+	int tilesX, tilesY;
+	std::vector<float> depth;
+	std::vector<float> tileMax;
+	glm::mat4 viewProj;
+	Stats counters;
+
+	// a triangle or a planar convex quad, in clip space
+	void rasterizePolygon(const glm::vec4* clip, int count);
+};
+
+#endif
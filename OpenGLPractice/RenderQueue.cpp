@@ -0,0 +1,97 @@
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+uint64_t RenderQueue::makeKey(unsigned int program, unsigned int textureSet, unsigned int VAO, float depth, float zNear, float zFar) {
+	const uint64_t depthMax = (1ull << DEPTH_BITS) - 1;
+
+	float t = (depth - zNear) / (zFar - zNear);
+	t = std::min(std::max(t, 0.0f), 1.0f);
+	uint64_t quantizedDepth = (uint64_t)(t * (float)depthMax);
+
+	uint64_t key = 0;
+	key |= (uint64_t)(program & ((1u << PROGRAM_BITS) - 1)) << (TEXTURE_SET_BITS + VAO_BITS + DEPTH_BITS);
+	key |= (uint64_t)(textureSet & ((1u << TEXTURE_SET_BITS) - 1)) << (VAO_BITS + DEPTH_BITS);
+	key |= (uint64_t)(VAO & ((1u << VAO_BITS) - 1)) << DEPTH_BITS;
+	key |= quantizedDepth;
+	return key;
+}
+
+unsigned int RenderQueue::addTextureSet(const std::vector<unsigned int>& textures) {
+	textureSets.push_back(textures);
+	return (unsigned int)textureSets.size() - 1;
+}
+
+void RenderQueue::submit(const RenderItem& item) {
+	queue.push_back(item);
+}
+
+// LSD radix sort, one byte per pass starting from the least significant.
+// every pass is stable so the order of the lower bytes survives the higher passes.
+// passes where every key has the same byte are skipped, which is common for the program and texture bytes
+void RenderQueue::sort() {
+	size_t n = queue.size();
+	if (n < 2)
+		return;
+
+	scratch.resize(n);
+
+	for (unsigned int pass = 0; pass < 8; pass++) {
+		unsigned int shift = pass * 8;
+		size_t counts[256] = {};
+
+		for (size_t i = 0; i < n; i++)
+			counts[(queue[i].key >> shift) & 0xFF]++;
+
+		if (counts[(queue[0].key >> shift) & 0xFF] == n)
+			continue;
+
+		size_t offsets[256];
+		size_t total = 0;
+		for (unsigned int b = 0; b < 256; b++) {
+			offsets[b] = total;
+			total += counts[b];
+		}
+
+		for (size_t i = 0; i < n; i++)
+			scratch[offsets[(queue[i].key >> shift) & 0xFF]++] = queue[i];
+
+		queue.swap(scratch);
+	}
+}
+
+void RenderQueue::execute(const std::function<void(const RenderItem&)>& draw) {
+	lastStats = {};
+	lastStats.items = (unsigned int)queue.size();
+
+	bool first = true;
+	unsigned int program = 0, textureSet = 0, VAO = 0;
+
+	for (const RenderItem& item : queue) {
+		if (first || item.program != program) {
+			glState.useProgram(item.program);
+			program = item.program;
+			lastStats.programChanges++;
+		}
+		if (first || item.textureSet != textureSet) {
+			const std::vector<unsigned int>& textures = textureSets[item.textureSet];
+			for (unsigned int unit = 0; unit < textures.size(); unit++)
+				glState.bindTexture(unit, textures[unit]);
+			textureSet = item.textureSet;
+			lastStats.textureChanges++;
+		}
+		if (first || item.VAO != VAO) {
+			glState.bindVertexArray(item.VAO);
+			VAO = item.VAO;
+			lastStats.VAOChanges++;
+		}
+		first = false;
+
+		draw(item);
+	}
+}
+
+void RenderQueue::clear() {
+	queue.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// one draw waiting in the queue. key decides the order, the rest is the state the draw needs
+struct RenderItem {
+	uint64_t key;
+	unsigned int program;
+	unsigned int textureSet;
+	unsigned int VAO;
+	unsigned int userData; // passed back untouched to the draw callback, e.g. an index into the callers objects
+};
+
+// collects draws tagged with a packed 64 bit key and sorts them with an LSD radix sort before submission,
+// so draws sharing a program, then textures, then VAO end up next to each other and state is only changed on transitions.
+//
+// key layout, most significant first:
+//   program ID (14 bits) | texture set (14 bits) | VAO (12 bits) | quantized depth (24 bits)
+class RenderQueue
+{
+public:
+	static const unsigned int PROGRAM_BITS = 14;
+	static const unsigned int TEXTURE_SET_BITS = 14;
+	static const unsigned int VAO_BITS = 12;
+	static const unsigned int DEPTH_BITS = 24;
+
+	// counts what the last execute() did, to compare against the number of items
+	struct Stats {
+		unsigned int items;
+		unsigned int programChanges;
+		unsigned int textureChanges;
+		unsigned int VAOChanges;
+	};
+
+	// packs the key. depth is the view space distance, clamped into [zNear, zFar] before quantizing
+	static uint64_t makeKey(unsigned int program, unsigned int textureSet, unsigned int VAO, float depth, float zNear, float zFar);
+
+	// a texture set is a list of textures bound to units 0..n in order. returns the id used in the key
+	unsigned int addTextureSet(const std::vector<unsigned int>& textures);
+
+	void submit(const RenderItem& item);
+	void sort();
+	// binds the state of every item in key order, only when it differs from the previous item, then calls draw for it
+	void execute(const std::function<void(const RenderItem&)>& draw);
+	void clear();
+
+	const std::vector<RenderItem>& items() const { return queue; }
+	const Stats& stats() const { return lastStats; }
+
+private:
+	std::vector<std::vector<unsigned int>> textureSets;
+	std::vector<RenderItem> queue;
+	std::vector<RenderItem> scratch;
+	Stats lastStats = {};
+};
+
+#endif
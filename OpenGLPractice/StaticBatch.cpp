@@ -0,0 +1,136 @@
+#include "StaticBatch.h"
+#include "GLStateCache.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+
+unsigned int StaticBatchBuilder::addMaterial(Shader* shader, const std::vector<unsigned int>& textures) {
+	Batch batch;
+	batch.shader = shader;
+	batch.textures = textures;
+	batch.VAO = 0;
+	batch.VBO = 0;
+	batch.vertexCount = 0;
+	batch.dirty = false;
+	batches.push_back(batch);
+	return (unsigned int)batches.size() - 1;
+}
+
+unsigned int StaticBatchBuilder::addMesh(const float* vertices, unsigned int vertexCount) {
+	Mesh mesh;
+	mesh.vertices.assign(vertices, vertices + vertexCount * FLOATS_PER_VERTEX);
+	meshes.push_back(mesh);
+	return (unsigned int)meshes.size() - 1;
+}
+
+unsigned int StaticBatchBuilder::addObject(unsigned int mesh, unsigned int material, const glm::mat4& model) {
+	unsigned int object;
+	if (!freeObjects.empty()) {
+		object = freeObjects.back();
+		freeObjects.pop_back();
+		objects[object] = { mesh, material, model, true };
+	}
+	else {
+		object = (unsigned int)objects.size();
+		objects.push_back({ mesh, material, model, true });
+	}
+
+	batches[material].objects.push_back(object);
+	batches[material].dirty = true;
+	return object;
+}
+
+void StaticBatchBuilder::removeObject(unsigned int object) {
+	Object& removed = objects[object];
+	if (!removed.alive)
+		return;
+
+	std::vector<unsigned int>& members = batches[removed.material].objects;
+	members.erase(std::find(members.begin(), members.end(), object));
+	batches[removed.material].dirty = true;
+
+	removed.alive = false;
+	freeObjects.push_back(object);
+}
+
+void StaticBatchBuilder::moveObject(unsigned int object, const glm::mat4& model) {
+	objects[object].model = model;
+	batches[objects[object].material].dirty = true;
+}
+
+void StaticBatchBuilder::rebuild(Batch& batch) {
+	std::vector<float> baked;
+	size_t floatCount = 0;
+	for (unsigned int object : batch.objects)
+		floatCount += meshes[objects[object].mesh].vertices.size();
+	baked.reserve(floatCount);
+
+	for (unsigned int object : batch.objects) {
+		const Object& source = objects[object];
+		const std::vector<float>& vertices = meshes[source.mesh].vertices;
+
+		for (size_t v = 0; v < vertices.size(); v += FLOATS_PER_VERTEX) {
+			glm::vec4 position = source.model * glm::vec4(vertices[v], vertices[v + 1], vertices[v + 2], 1.0f);
+			baked.push_back(position.x);
+			baked.push_back(position.y);
+			baked.push_back(position.z);
+			baked.push_back(vertices[v + 3]);
+			baked.push_back(vertices[v + 4]);
+		}
+	}
+
+	if (batch.VAO == 0) {
+		glGenVertexArrays(1, &batch.VAO);
+		glGenBuffers(1, &batch.VBO);
+
+		glState.bindVertexArray(batch.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+		VertexLayout layout;
+		layout.add(SEMANTIC_POSITION, 0, VERTEX_FLOAT3).add(SEMANTIC_TEXCOORD, 1, VERTEX_FLOAT2);
+		layout.apply();
+		glState.bindVertexArray(0);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, baked.size() * sizeof(float), baked.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	batch.vertexCount = (GLsizei)(baked.size() / FLOATS_PER_VERTEX);
+	batch.dirty = false;
+	rebuilds++;
+}
+
+void StaticBatchBuilder::update() {
+	rebuilds = 0;
+	for (Batch& batch : batches) {
+		if (batch.dirty)
+			rebuild(batch);
+	}
+}
+
+void StaticBatchBuilder::draw() {
+	for (const Batch& batch : batches) {
+		if (batch.vertexCount == 0)
+			continue;
+
+		batch.shader->use();
+		for (unsigned int unit = 0; unit < batch.textures.size(); unit++)
+			glState.bindTexture(unit, batch.textures[unit]);
+
+		glState.bindVertexArray(batch.VAO);
+		glDrawArrays(GL_TRIANGLES, 0, batch.vertexCount);
+	}
+}
+
+void StaticBatchBuilder::discard() {
+	for (Batch& batch : batches) {
+		if (batch.VAO == 0)
+			continue;
+		glState.deleteVertexArray(batch.VAO);
+		glDeleteBuffers(1, &batch.VBO);
+		batch.VAO = 0;
+		batch.VBO = 0;
+	}
+}
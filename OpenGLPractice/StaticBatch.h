@@ -0,0 +1,67 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include "shader.h"
+
+// bakes objects that never move into one pre-transformed vertex buffer per material, drawn with a single glDrawArrays.
+// vertices use the same layout as main.cpp: position (3 floats) followed by texture coordinates (2 floats).
+// the shader has to take world space positions, see staticVertexShader.vs.
+// adding, removing or moving an object only marks its material's batch dirty, update() rebuilds the dirty ones.
+// a batch is drawn whole, so this is for scenery that is not worth culling object by object
+class StaticBatchBuilder
+{
+public:
+	static const unsigned int FLOATS_PER_VERTEX = 5;
+
+	unsigned int addMaterial(Shader* shader, const std::vector<unsigned int>& textures);
+	// copies the vertex data, returns the mesh id
+	unsigned int addMesh(const float* vertices, unsigned int vertexCount);
+
+	// returns a handle that stays valid until the object is removed
+	unsigned int addObject(unsigned int mesh, unsigned int material, const glm::mat4& model);
+	void removeObject(unsigned int object);
+	void moveObject(unsigned int object, const glm::mat4& model);
+
+	// rebuilds the batches touched since the last update
+	void update();
+	void draw();
+	void discard();
+
+	unsigned int batchCount() const { return (unsigned int)batches.size(); }
+	unsigned int rebuildsLastUpdate() const { return rebuilds; }
+
+private:
+	struct Mesh {
+		std::vector<float> vertices;
+	};
+
+	struct Object {
+		unsigned int mesh;
+		unsigned int material;
+		glm::mat4 model;
+		bool alive;
+	};
+
+	struct Batch {
+		Shader* shader;
+		std::vector<unsigned int> textures;
+		std::vector<unsigned int> objects;
+		unsigned int VAO;
+		unsigned int VBO;
+		GLsizei vertexCount;
+		bool dirty;
+	};
+
+	std::vector<Mesh> meshes;
+	std::vector<Object> objects;
+	std::vector<unsigned int> freeObjects;
+	std::vector<Batch> batches;
+	unsigned int rebuilds = 0;
+
+	void rebuild(Batch& batch);
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLenum target, size_t frameSize) : target(target), regionSize(frameSize), persistentData(NULL), frameData(NULL), frame(0), cursor(0)
+{
+	for (unsigned int i = 0; i < FRAME_COUNT; i++)
+		fences[i] = NULL;
+
+	persistent = GLAD_GL_VERSION_4_4 != 0;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+
+	GLsizeiptr totalSize = (GLsizeiptr)(regionSize * FRAME_COUNT);
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, totalSize, NULL, flags);
+		persistentData = (unsigned char*)glMapBufferRange(target, 0, totalSize, flags);
+
+		if (persistentData == NULL) {
+			std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+			persistent = false;
+			// immutable storage cannot be respecified, so the fallback needs a new buffer
+			glBindBuffer(target, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(target, buffer);
+		}
+	}
+	if (!persistent)
+		glBufferData(target, totalSize, NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(target, 0);
+}
+
+void StreamBuffer::waitForFence(GLsync& fence) {
+	if (fence == NULL)
+		return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+	glDeleteSync(fence);
+	fence = NULL;
+}
+
+void StreamBuffer::beginFrame() {
+	waitForFence(fences[frame]);
+	cursor = 0;
+
+	if (persistent) {
+		frameData = persistentData + frame * regionSize;
+	}
+	else {
+		glBindBuffer(target, buffer);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		frameData = (unsigned char*)glMapBufferRange(target, (GLintptr)(frame * regionSize), (GLsizeiptr)regionSize, flags);
+		glBindBuffer(target, 0);
+	}
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment) {
+	size_t start = (cursor + alignment - 1) / alignment * alignment;
+	if (frameData == NULL || start + size > regionSize)
+		return { NULL, 0 };
+
+	cursor = start + size;
+	return { frameData + start, (GLintptr)(frame * regionSize + start) };
+}
+
+void StreamBuffer::commit() {
+	if (persistent || frameData == NULL)
+		return;
+
+	glBindBuffer(target, buffer);
+	glUnmapBuffer(target);
+	glBindBuffer(target, 0);
+	frameData = NULL;
+}
+
+void StreamBuffer::endFrame() {
+	commit();
+	frameData = NULL;
+	fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame = (frame + 1) % FRAME_COUNT;
+}
+
+void StreamBuffer::discard() {
+	for (unsigned int i = 0; i < FRAME_COUNT; i++) {
+		if (fences[i] != NULL)
+			glDeleteSync(fences[i]);
+		fences[i] = NULL;
+	}
+
+	if (persistent) {
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+	}
+	glDeleteBuffers(1, &buffer);
+}
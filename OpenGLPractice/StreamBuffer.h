@@ -0,0 +1,55 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// ring buffer for data rewritten every frame (instance matrices, particles, debug lines).
+// the buffer is split into three frame regions. the CPU writes into one while the GPU may still read the other two,
+// and a fence per region makes sure a region is only reused once the GPU is done with it.
+//
+// with glBufferStorage (4.4) the buffer is mapped once, persistently and coherently.
+// otherwise the current region is mapped every frame with unsynchronized + invalidate range, which is safe because of the fences.
+//
+// per frame: beginFrame, allocate as often as needed, commit, draw using the offsets, endFrame
+class StreamBuffer
+{
+public:
+	static const unsigned int FRAME_COUNT = 3;
+
+	struct Allocation {
+		void* data;        // where the CPU writes, NULL if the frame region is full
+		GLintptr offset;   // byte offset inside the GL buffer to point attributes or glBindBufferRange at
+	};
+
+	StreamBuffer(GLenum target, size_t frameSize);
+
+	void beginFrame();
+	Allocation allocate(size_t size, size_t alignment = 16);
+	// makes the writes of this frame visible to GL. must be called before drawing from the buffer
+	void commit();
+	// fences the region of this frame and moves on to the next one
+	void endFrame();
+	void discard();
+
+	unsigned int ID() const { return buffer; }
+	bool isPersistent() const { return persistent; }
+	size_t frameSize() const { return regionSize; }
+
+private:
+	GLenum target;
+	unsigned int buffer;
+	size_t regionSize;
+	bool persistent;
+
+	unsigned char* persistentData;
+	unsigned char* frameData;
+	unsigned int frame;
+	size_t cursor;
+	GLsync fences[FRAME_COUNT];
+
+	void waitForFence(GLsync& fence);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount) : running(0), stopping(false)
+{
+	if (threadCount == 0) {
+		// hardware_concurrency() is 0 when it cannot tell
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	allDone.wait(lock, [this]() { return tasks.empty() && running == 0; });
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)>& body) {
+	struct State {
+		std::atomic<unsigned int> next;
+		unsigned int count;
+		const std::function<void(unsigned int)>* body;
+		std::mutex mutex;
+		std::condition_variable finished;
+		unsigned int running;
+	};
+	// helpers that only get to run after everything is done must still find valid state, so it is shared
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->next = 0;
+	state->count = count;
+	state->body = &body;
+	state->running = 0;
+
+	auto run = [](State& s) {
+		for (unsigned int i = s.next++; i < s.count; i = s.next++)
+			(*s.body)(i);
+	};
+
+	unsigned int helpers = std::min(threadCount(), count > 0 ? count - 1 : 0);
+	for (unsigned int h = 0; h < helpers; h++) {
+		submit([state, run]() {
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (state->next >= state->count)
+					return;
+				state->running++;
+			}
+			run(*state);
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->running--;
+			}
+			state->finished.notify_all();
+		});
+	}
+
+	// the caller takes work too, so this finishes even when every worker is busy with something else
+	run(*state);
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->running == 0; });
+}
+
+unsigned int ThreadPool::pendingTasks() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return (unsigned int)tasks.size() + running;
+}
+
+void ThreadPool::work() {
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			// whatever is still queued when stopping is dropped
+			if (stopping)
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+			running++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running--;
+			if (tasks.empty() && running == 0)
+				allDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads running queued tasks in submission order.
+// tasks must not touch GL, the context only lives on the main thread
+class ThreadPool
+{
+public:
+	// 0 means one thread per core, leaving one for the main thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task);
+	// blocks until the queue is empty and no task is running
+	void wait();
+	// runs body(0) to body(count - 1) on the workers and the calling thread, returns when all of them are done.
+	// only waits for its own work, not for other tasks in the queue
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+
+	unsigned int threadCount() const { return (unsigned int)workers.size(); }
+	unsigned int pendingTasks();
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::condition_variable allDone;
+	unsigned int running;
+	bool stopping;
+
+	void work();
+};
+
+#endif
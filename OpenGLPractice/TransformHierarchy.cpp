@@ -0,0 +1,203 @@
+#include "TransformHierarchy.h"
+#include "AffineTransform.h"
+#include "Benchmark.h"
+
+#include <atomic>
+
+const unsigned int TransformHierarchy::NO_PARENT;
+
+namespace {
+	// below this many flagged nodes handing work to other threads costs more than it saves
+	const unsigned int PARALLEL_MIN_NODES = 4096;
+
+	bool isTranslation(const glm::quat& rotation, const glm::vec3& scale) {
+		return rotation.x == 0.0f && rotation.y == 0.0f && rotation.z == 0.0f && scale == glm::vec3(1.0f);
+	}
+}
+
+unsigned int TransformHierarchy::add(unsigned int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	unsigned int handle = (unsigned int)parentOf.size();
+	parentOf.push_back(parent);
+
+	// appended for now, reorder() moves it next to its parent before the next update
+	index.push_back(locals.add(position, rotation, scale));
+	parents.push_back(parent == NO_PARENT ? NO_PARENT : index[parent]);
+	groupOf.push_back(0);
+	worlds.push_back(glm::mat4(1.0f));
+	dirty.push_back(1);
+	orderDirty = true;
+	return handle;
+}
+
+void TransformHierarchy::setLocal(unsigned int node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	unsigned int i = index[node];
+	locals.setPosition(i, position);
+	locals.setRotation(i, rotation);
+	locals.setScale(i, scale);
+	markDirty(i);
+}
+
+void TransformHierarchy::setLocalPosition(unsigned int node, const glm::vec3& position) {
+	locals.setPosition(index[node], position);
+	markDirty(index[node]);
+}
+
+void TransformHierarchy::setLocalRotation(unsigned int node, const glm::quat& rotation) {
+	locals.setRotation(index[node], rotation);
+	markDirty(index[node]);
+}
+
+void TransformHierarchy::markDirty(unsigned int i) {
+	dirty[i] = 1;
+	if (orderDirty)
+		return;
+	Group& group = groups[groupOf[i]];
+	if (!group.dirty) {
+		group.dirty = true;
+		dirtyGroups.push_back(groupOf[i]);
+	}
+}
+
+// breadth first from every root, in the order the roots were added
+void TransformHierarchy::reorder() {
+	unsigned int count = size();
+	std::vector<std::vector<unsigned int>> children(count);
+	std::vector<unsigned int> roots;
+	for (unsigned int handle = 0; handle < count; handle++) {
+		if (parentOf[handle] == NO_PARENT)
+			roots.push_back(handle);
+		else
+			children[parentOf[handle]].push_back(handle);
+	}
+
+	std::vector<unsigned int> order;
+	order.reserve(count);
+	groups.clear();
+	for (unsigned int root : roots) {
+		Group group = { (unsigned int)order.size(), 0, true };
+		order.push_back(root);
+		for (size_t next = group.begin; next < order.size(); next++)
+			for (unsigned int child : children[order[next]])
+				order.push_back(child);
+		group.end = (unsigned int)order.size();
+		groups.push_back(group);
+	}
+
+	TransformStore sorted;
+	sorted.reserve(count);
+	std::vector<unsigned int> newIndex(count);
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int old = index[order[i]];
+		sorted.add(locals.position(old), locals.rotation(old), locals.scale(old));
+		newIndex[order[i]] = i;
+	}
+	locals = sorted;
+	index = newIndex;
+
+	dirtyGroups.clear();
+	for (unsigned int g = 0; g < groups.size(); g++) {
+		dirtyGroups.push_back(g);
+		for (unsigned int i = groups[g].begin; i < groups[g].end; i++) {
+			unsigned int parent = parentOf[order[i]];
+			parents[i] = parent == NO_PARENT ? NO_PARENT : index[parent];
+			groupOf[i] = g;
+			dirty[i] = 1;
+		}
+	}
+	orderDirty = false;
+}
+
+unsigned int TransformHierarchy::updateGroup(const Group& group) {
+	unsigned int count = 0;
+	for (unsigned int i = group.begin; i < group.end; i++) {
+		unsigned int parent = parents[i];
+		// the parent was handled earlier in this pass, its flag says whether its world matrix changed
+		if (!dirty[i] && (parent == NO_PARENT || !dirty[parent]))
+			continue;
+
+		dirty[i] = 1;
+		// composed as 3x4 affines, children that are only offset from their parent cost a point transform
+		glm::quat rotation = locals.rotation(i);
+		glm::vec3 scale = locals.scale(i);
+		if (parent == NO_PARENT)
+			worlds[i] = locals.model(i);
+		else if (isTranslation(rotation, scale))
+			worlds[i] = (GeneralTransform::fromMat4(worlds[parent]) * TranslationTransform(locals.position(i))).toMat4();
+		else
+			worlds[i] = (GeneralTransform::fromMat4(worlds[parent]) * GeneralTransform::fromTRS(locals.position(i), rotation, scale)).toMat4();
+		count++;
+	}
+
+	for (unsigned int i = group.begin; i < group.end; i++)
+		dirty[i] = 0;
+	return count;
+}
+
+void TransformHierarchy::update(ThreadPool* pool) {
+	if (orderDirty)
+		reorder();
+
+	updated = 0;
+	if (dirtyGroups.empty())
+		return;
+
+	unsigned int flaggedNodes = 0;
+	for (unsigned int g : dirtyGroups)
+		flaggedNodes += groups[g].end - groups[g].begin;
+
+	if (pool && pool->threadCount() > 0 && flaggedNodes >= PARALLEL_MIN_NODES && dirtyGroups.size() > 1) {
+		std::atomic<unsigned int> total(0);
+		pool->parallelFor((unsigned int)dirtyGroups.size(), [this, &total](unsigned int g) {
+			total += updateGroup(groups[dirtyGroups[g]]);
+		});
+		updated = total;
+	}
+	else {
+		for (unsigned int g : dirtyGroups)
+			updated += updateGroup(groups[g]);
+	}
+
+	for (unsigned int g : dirtyGroups)
+		groups[g].dirty = false;
+	dirtyGroups.clear();
+}
+
+HierarchyBenchmarkResult TransformHierarchyBenchmark::run(ThreadPool& pool, unsigned int roots, unsigned int depth, unsigned int iterations) {
+	TransformHierarchy hierarchy;
+	std::vector<unsigned int> rootHandles;
+	glm::quat turn = glm::angleAxis(0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (unsigned int r = 0; r < roots; r++) {
+		unsigned int root = hierarchy.add(TransformHierarchy::NO_PARENT, glm::vec3((float)r, 0.0f, 0.0f));
+		rootHandles.push_back(root);
+		std::vector<unsigned int> level = { root };
+		for (unsigned int d = 1; d < depth; d++) {
+			std::vector<unsigned int> next;
+			for (unsigned int parent : level)
+				for (unsigned int c = 0; c < 4; c++)
+					next.push_back(hierarchy.add(parent, glm::vec3(0.0f, 1.0f, (float)c), turn, glm::vec3(0.9f)));
+			level.swap(next);
+		}
+	}
+	hierarchy.update();
+
+	HierarchyBenchmarkResult result;
+	result.nodeCount = hierarchy.size();
+	result.depth = depth;
+	float angle = 0.0f;
+	auto moveRoots = [&]() {
+		angle += 0.01f;
+		for (unsigned int root : rootHandles)
+			hierarchy.setLocalRotation(root, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+	};
+
+	result.allDirtyMs = Benchmark::averageMs(iterations, [&]() { moveRoots(); hierarchy.update(); });
+	result.allDirtyParallelMs = Benchmark::averageMs(iterations, [&]() { moveRoots(); hierarchy.update(&pool); });
+	result.oneSubtreeMs = Benchmark::averageMs(iterations, [&]() {
+		angle += 0.01f;
+		hierarchy.setLocalRotation(rootHandles[0], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+		hierarchy.update(&pool);
+	});
+	result.cleanMs = Benchmark::averageMs(iterations, [&]() { hierarchy.update(&pool); });
+	return result;
+}
@@ -0,0 +1,74 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <cstdint>
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "TransformStore.h"
+#include "ThreadPool.h"
+
+// parent/child transforms. nodes are kept grouped by root, and inside a group sorted by depth, so every parent comes before
+// its children and one linear pass over a group rebuilds its world matrices. setting a local transform flags the node,
+// the pass recomputes flagged nodes and everything below them and skips groups with nothing flagged.
+// groups are independent, update() hands them out to worker threads
+class TransformHierarchy
+{
+public:
+	static const unsigned int NO_PARENT = 0xFFFFFFFF;
+
+	// the parent has to exist already. returns a handle that stays valid, the storage order is internal
+	unsigned int add(unsigned int parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+
+	void setLocal(unsigned int node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	void setLocalPosition(unsigned int node, const glm::vec3& position);
+	void setLocalRotation(unsigned int node, const glm::quat& rotation);
+
+	// pool may be null, small updates stay on the calling thread either way
+	void update(ThreadPool* pool = nullptr);
+
+	const glm::mat4& world(unsigned int node) const { return worlds[index[node]]; }
+	unsigned int size() const { return (unsigned int)parentOf.size(); }
+	unsigned int updatedLastUpdate() const { return updated; }
+
+private:
+	struct Group {
+		unsigned int begin, end;
+		bool dirty;
+	};
+
+	// by handle
+	std::vector<unsigned int> parentOf;
+	std::vector<unsigned int> index;
+
+	// by storage index
+	TransformStore locals;
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> groupOf;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+
+	std::vector<Group> groups;
+	std::vector<unsigned int> dirtyGroups;
+	bool orderDirty = false;
+	unsigned int updated = 0;
+
+	void markDirty(unsigned int node);
+	void reorder();
+	unsigned int updateGroup(const Group& group);
+};
+
+struct HierarchyBenchmarkResult {
+	unsigned int nodeCount;
+	unsigned int depth;
+	double allDirtyMs;
+	double allDirtyParallelMs;
+	double oneSubtreeMs;
+	double cleanMs;
+};
+
+namespace TransformHierarchyBenchmark {
+	// roots with four children per node down to depth levels, average time per update over the iterations
+	HierarchyBenchmarkResult run(ThreadPool& pool, unsigned int roots, unsigned int depth, unsigned int iterations);
+}
+
+#endif
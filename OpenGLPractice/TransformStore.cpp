@@ -0,0 +1,188 @@
+#include "TransformStore.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <xmmintrin.h>
+#include "glm\glm\gtc\matrix_transform.hpp"
+
+unsigned int TransformStore::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	px.push_back(position.x); py.push_back(position.y); pz.push_back(position.z);
+	qx.push_back(rotation.x); qy.push_back(rotation.y); qz.push_back(rotation.z); qw.push_back(rotation.w);
+	sx.push_back(scale.x); sy.push_back(scale.y); sz.push_back(scale.z);
+	return count++;
+}
+
+void TransformStore::clear() {
+	for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz, &qw, &sx, &sy, &sz })
+		component->clear();
+	count = 0;
+}
+
+void TransformStore::reserve(unsigned int count) {
+	for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz, &qw, &sx, &sy, &sz })
+		component->reserve(count);
+}
+
+void TransformStore::setPosition(unsigned int i, const glm::vec3& position) {
+	px[i] = position.x; py[i] = position.y; pz[i] = position.z;
+}
+
+void TransformStore::setRotation(unsigned int i, const glm::quat& rotation) {
+	qx[i] = rotation.x; qy[i] = rotation.y; qz[i] = rotation.z; qw[i] = rotation.w;
+}
+
+void TransformStore::setScale(unsigned int i, const glm::vec3& scale) {
+	sx[i] = scale.x; sy[i] = scale.y; sz[i] = scale.z;
+}
+
+void TransformStore::computeModels(std::vector<glm::mat4>& models) const {
+	compose<false>(glm::mat4(1.0f), models);
+}
+
+void TransformStore::computeMVPs(const glm::mat4& viewProj, std::vector<glm::mat4>& mvps) const {
+	compose<true>(viewProj, mvps);
+}
+
+glm::mat4 TransformStore::model(unsigned int i) const {
+	float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+	glm::mat4 m;
+	m[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx[i], 2.0f * (x * y + w * z) * sx[i], 2.0f * (x * z - w * y) * sx[i], 0.0f);
+	m[1] = glm::vec4(2.0f * (x * y - w * z) * sy[i], (1.0f - 2.0f * (x * x + z * z)) * sy[i], 2.0f * (y * z + w * x) * sy[i], 0.0f);
+	m[2] = glm::vec4(2.0f * (x * z + w * y) * sz[i], 2.0f * (y * z - w * x) * sz[i], (1.0f - 2.0f * (x * x + y * y)) * sz[i], 0.0f);
+	m[3] = glm::vec4(px[i], py[i], pz[i], 1.0f);
+	return m;
+}
+
+void TransformStore::computeModelsScalar(std::vector<glm::mat4>& models) const {
+	models.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		models[i] = model(i);
+}
+
+// four objects per step. every matrix element is computed for all four lanes at once, then each column is transposed
+// from one register per element into one register per object and stored. the last count % 4 objects go through the scalar path
+template <bool withViewProj>
+void TransformStore::compose(const glm::mat4& viewProj, std::vector<glm::mat4>& out) const {
+	out.resize(count);
+
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	__m128 vp[4][4];
+	if (withViewProj) {
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				vp[c][r] = _mm_set1_ps(viewProj[c][r]);
+	}
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(&qx[i]), y = _mm_loadu_ps(&qy[i]), z = _mm_loadu_ps(&qz[i]), w = _mm_loadu_ps(&qw[i]);
+		__m128 scaleX = _mm_loadu_ps(&sx[i]), scaleY = _mm_loadu_ps(&sy[i]), scaleZ = _mm_loadu_ps(&sz[i]);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		// m[column][row] of the model matrix, one lane per object
+		__m128 m[4][4];
+		m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+		m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+		m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+		m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+		m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+		m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+		m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+		m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+		m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+		m[3][0] = _mm_loadu_ps(&px[i]);
+		m[3][1] = _mm_loadu_ps(&py[i]);
+		m[3][2] = _mm_loadu_ps(&pz[i]);
+		m[0][3] = m[1][3] = m[2][3] = zero;
+		m[3][3] = one;
+
+		if (withViewProj) {
+			// the model's bottom row is (0, 0, 0, 1), so each column needs three products, plus the translation of viewProj for the last
+			__m128 result[4][4];
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 4; r++) {
+					__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vp[0][r], m[c][0]), _mm_mul_ps(vp[1][r], m[c][1])), _mm_mul_ps(vp[2][r], m[c][2]));
+					result[c][r] = c == 3 ? _mm_add_ps(sum, vp[3][r]) : sum;
+				}
+			}
+			for (int c = 0; c < 4; c++)
+				for (int r = 0; r < 4; r++)
+					m[c][r] = result[c][r];
+		}
+
+		for (int c = 0; c < 4; c++) {
+			__m128 r0 = m[c][0], r1 = m[c][1], r2 = m[c][2], r3 = m[c][3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(&out[i][c][0], r0);
+			_mm_storeu_ps(&out[i + 1][c][0], r1);
+			_mm_storeu_ps(&out[i + 2][c][0], r2);
+			_mm_storeu_ps(&out[i + 3][c][0], r3);
+		}
+	}
+
+	for (; i < count; i++)
+		out[i] = withViewProj ? viewProj * model(i) : model(i);
+}
+
+template void TransformStore::compose<false>(const glm::mat4&, std::vector<glm::mat4>&) const;
+template void TransformStore::compose<true>(const glm::mat4&, std::vector<glm::mat4>&) const;
+
+TransformBenchmarkResult TransformKernels::benchmark(unsigned int objectCount, unsigned int iterations) {
+	std::mt19937 random(1234);
+
+	TransformStore store;
+	store.reserve(objectCount);
+	std::vector<glm::vec3> positions, axes, scales;
+	std::vector<float> angles;
+	for (unsigned int i = 0; i < objectCount; i++) {
+		positions.push_back(Benchmark::randomVec3(random, -100.0f, 100.0f));
+		axes.push_back(Benchmark::randomAxis(random));
+		angles.push_back(Benchmark::randomAngle(random));
+		scales.push_back(Benchmark::randomVec3(random, 0.5f, 2.0f));
+		store.add(positions[i], glm::angleAxis(angles[i], axes[i]), scales[i]);
+	}
+
+	glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 300.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<glm::mat4> glmModels(objectCount), glmMVPs(objectCount), models, mvps;
+
+	TransformBenchmarkResult result;
+	result.objectCount = objectCount;
+	// the way main.cpp used to build its model matrices
+	result.glmModelMs = Benchmark::averageMs(iterations, [&]() {
+		for (unsigned int i = 0; i < objectCount; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+			model = glm::rotate(model, angles[i], axes[i]);
+			glmModels[i] = glm::scale(model, scales[i]);
+		}
+	});
+	result.glmMVPMs = Benchmark::averageMs(iterations, [&]() {
+		for (unsigned int i = 0; i < objectCount; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+			model = glm::rotate(model, angles[i], axes[i]);
+			glmMVPs[i] = viewProj * glm::scale(model, scales[i]);
+		}
+	});
+	result.scalarModelMs = Benchmark::averageMs(iterations, [&]() { store.computeModelsScalar(models); });
+	result.sseModelMs = Benchmark::averageMs(iterations, [&]() { store.computeModels(models); });
+	result.sseMVPMs = Benchmark::averageMs(iterations, [&]() { store.computeMVPs(viewProj, mvps); });
+
+	result.maxError = 0.0f;
+	for (unsigned int i = 0; i < objectCount; i++) {
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				result.maxError = std::max(result.maxError, std::fabs(models[i][c][r] - glmModels[i][c][r]));
+				// clip space values grow with distance, compared relative to their size
+				float scale = std::max(1.0f, std::fabs(glmMVPs[i][c][r]));
+				result.maxError = std::max(result.maxError, std::fabs(mvps[i][c][r] - glmMVPs[i][c][r]) / scale);
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,63 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "glm\glm\gtc\quaternion.hpp"
+
+// positions, rotations and scales of many objects kept as structure of arrays, one float array per component,
+// so the kernels below load the same component of four objects with one SSE load.
+// rotations are unit quaternions
+class TransformStore
+{
+public:
+	unsigned int add(const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	void clear();
+	void reserve(unsigned int count);
+	unsigned int size() const { return count; }
+
+	void setPosition(unsigned int i, const glm::vec3& position);
+	void setRotation(unsigned int i, const glm::quat& rotation);
+	void setScale(unsigned int i, const glm::vec3& scale);
+	glm::vec3 position(unsigned int i) const { return glm::vec3(px[i], py[i], pz[i]); }
+	glm::quat rotation(unsigned int i) const { return glm::quat(qw[i], qx[i], qy[i], qz[i]); }
+	glm::vec3 scale(unsigned int i) const { return glm::vec3(sx[i], sy[i], sz[i]); }
+
+	// translate * rotate * scale of one object
+	glm::mat4 model(unsigned int i) const;
+	// translate * rotate * scale of every object, models is resized to size()
+	void computeModels(std::vector<glm::mat4>& models) const;
+	// viewProj * translate * rotate * scale of every object
+	void computeMVPs(const glm::mat4& viewProj, std::vector<glm::mat4>& mvps) const;
+
+	// plain loop over the same arrays, the reference for the SSE kernels
+	void computeModelsScalar(std::vector<glm::mat4>& models) const;
+
+private:
+	std::vector<float> px, py, pz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+	unsigned int count = 0;
+
+	template <bool withViewProj>
+	void compose(const glm::mat4& viewProj, std::vector<glm::mat4>& out) const;
+};
+
+struct TransformBenchmarkResult {
+	unsigned int objectCount;
+	// per object translate/rotate/scale/multiply with glm
+	double glmModelMs;
+	double glmMVPMs;
+	double scalarModelMs;
+	double sseModelMs;
+	double sseMVPMs;
+	// largest difference of any matrix element between the SSE and glm results
+	float maxError;
+};
+
+namespace TransformKernels {
+	// random transforms from a fixed seed, average time per pass over the iterations
+	TransformBenchmarkResult benchmark(unsigned int objectCount, unsigned int iterations);
+}
+
+#endif
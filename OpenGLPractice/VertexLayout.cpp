@@ -0,0 +1,180 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+unsigned int VertexLayout::formatSize(VertexFormat format) {
+	switch (format) {
+	case VERTEX_FLOAT2: return 8;
+	case VERTEX_FLOAT3: return 12;
+	case VERTEX_FLOAT4: return 16;
+	case VERTEX_HALF2: return 4;
+	case VERTEX_HALF4: return 8;
+	case VERTEX_UNORM16_2: return 4;
+	case VERTEX_SNORM_10_10_10_2: return 4;
+	case VERTEX_UNORM8_4: return 4;
+	}
+	return 0;
+}
+
+unsigned int VertexLayout::formatComponents(VertexFormat format) {
+	switch (format) {
+	case VERTEX_FLOAT2: return 2;
+	case VERTEX_FLOAT3: return 3;
+	case VERTEX_FLOAT4: return 4;
+	case VERTEX_HALF2: return 2;
+	case VERTEX_HALF4: return 4;
+	case VERTEX_UNORM16_2: return 2;
+	case VERTEX_SNORM_10_10_10_2: return 4;
+	case VERTEX_UNORM8_4: return 4;
+	}
+	return 0;
+}
+
+VertexLayout& VertexLayout::add(VertexSemantic semantic, unsigned int location, VertexFormat format) {
+	attribs.push_back({ semantic, location, format, vertexStride });
+	vertexStride += formatSize(format);
+	return *this;
+}
+
+const VertexAttribute* VertexLayout::find(VertexSemantic semantic) const {
+	for (const VertexAttribute& attrib : attribs) {
+		if (attrib.semantic == semantic)
+			return &attrib;
+	}
+	return nullptr;
+}
+
+void VertexLayout::apply() const {
+	for (const VertexAttribute& attrib : attribs) {
+		GLenum type = GL_FLOAT;
+		GLboolean normalized = GL_FALSE;
+
+		switch (attrib.format) {
+		case VERTEX_FLOAT2:
+		case VERTEX_FLOAT3:
+		case VERTEX_FLOAT4:
+			break;
+		case VERTEX_HALF2:
+		case VERTEX_HALF4:
+			type = GL_HALF_FLOAT;
+			break;
+		case VERTEX_UNORM16_2:
+			type = GL_UNSIGNED_SHORT;
+			normalized = GL_TRUE;
+			break;
+		case VERTEX_SNORM_10_10_10_2:
+			type = GL_INT_2_10_10_10_REV;
+			normalized = GL_TRUE;
+			break;
+		case VERTEX_UNORM8_4:
+			type = GL_UNSIGNED_BYTE;
+			normalized = GL_TRUE;
+			break;
+		}
+
+		glVertexAttribPointer(attrib.location, formatComponents(attrib.format), type, normalized, vertexStride, (void*)(size_t)attrib.offset);
+		glEnableVertexAttribArray(attrib.location);
+	}
+}
+
+// rounds to nearest even, overflows to infinity and flushes values below the smallest denormal to zero
+uint16_t VertexConvert::floatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int exponent = (int)floatExponent - 127 + 15;
+
+	if (floatExponent == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7C00);
+
+	if (exponent <= 0) {
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t middle = 1u << (shift - 1);
+		if (rest > middle || (rest == middle && (half & 1)))
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	return (uint16_t)half;
+}
+
+uint16_t VertexConvert::packUnorm16(float value) {
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return (uint16_t)std::lround(value * 65535.0f);
+}
+
+uint32_t VertexConvert::packSnorm1010102(float x, float y, float z) {
+	auto pack = [](float value) {
+		value = std::min(std::max(value, -1.0f), 1.0f);
+		return (uint32_t)(std::lround(value * 511.0f)) & 0x3FF;
+	};
+	return pack(x) | (pack(y) << 10) | (pack(z) << 20);
+}
+
+std::vector<uint8_t> VertexConvert::convert(const float* vertices, unsigned int vertexCount, const VertexLayout& source, const VertexLayout& target) {
+	std::vector<uint8_t> packed((size_t)vertexCount * target.stride(), 0);
+	const uint8_t* sourceBytes = (const uint8_t*)vertices;
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		const uint8_t* in = sourceBytes + (size_t)v * source.stride();
+		uint8_t* out = packed.data() + (size_t)v * target.stride();
+
+		for (const VertexAttribute& attrib : target.attributes()) {
+			const VertexAttribute* from = source.find(attrib.semantic);
+			if (from == nullptr)
+				continue;
+
+			// missing components default to 0, except w of a position which is 1
+			float value[4] = { 0.0f, 0.0f, 0.0f, attrib.semantic == SEMANTIC_POSITION ? 1.0f : 0.0f };
+			std::memcpy(value, in + from->offset, VertexLayout::formatComponents(from->format) * sizeof(float));
+
+			uint8_t* dst = out + attrib.offset;
+			switch (attrib.format) {
+			case VERTEX_FLOAT2:
+			case VERTEX_FLOAT3:
+			case VERTEX_FLOAT4:
+				std::memcpy(dst, value, VertexLayout::formatSize(attrib.format));
+				break;
+			case VERTEX_HALF2:
+			case VERTEX_HALF4:
+				for (unsigned int c = 0; c < VertexLayout::formatComponents(attrib.format); c++) {
+					uint16_t half = floatToHalf(value[c]);
+					std::memcpy(dst + c * sizeof(uint16_t), &half, sizeof(half));
+				}
+				break;
+			case VERTEX_UNORM16_2:
+				for (unsigned int c = 0; c < 2; c++) {
+					uint16_t unorm = packUnorm16(value[c]);
+					std::memcpy(dst + c * sizeof(uint16_t), &unorm, sizeof(unorm));
+				}
+				break;
+			case VERTEX_SNORM_10_10_10_2: {
+				uint32_t normal = packSnorm1010102(value[0], value[1], value[2]);
+				std::memcpy(dst, &normal, sizeof(normal));
+				break;
+			}
+			case VERTEX_UNORM8_4:
+				for (unsigned int c = 0; c < 4; c++)
+					dst[c] = (uint8_t)std::lround(std::min(std::max(value[c], 0.0f), 1.0f) * 255.0f);
+				break;
+			}
+		}
+	}
+	return packed;
+}
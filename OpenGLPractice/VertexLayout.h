@@ -0,0 +1,69 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+enum VertexSemantic {
+	SEMANTIC_POSITION,
+	SEMANTIC_TEXCOORD,
+	SEMANTIC_NORMAL,
+	SEMANTIC_COLOR
+};
+
+// how one attribute is stored in the buffer. every format is a multiple of 4 bytes so attributes stay aligned
+enum VertexFormat {
+	VERTEX_FLOAT2,
+	VERTEX_FLOAT3,
+	VERTEX_FLOAT4,
+	VERTEX_HALF2,
+	VERTEX_HALF4,            // 3 component data gets w = 1, vec3 shader inputs simply ignore it
+	VERTEX_UNORM16_2,        // [0, 1] only, texture coordinates outside of it are clamped
+	VERTEX_SNORM_10_10_10_2, // unit vectors such as normals, w is 0
+	VERTEX_UNORM8_4          // colours
+};
+
+struct VertexAttribute {
+	VertexSemantic semantic;
+	unsigned int location;
+	VertexFormat format;
+	unsigned int offset;
+};
+
+// describes an interleaved vertex: which attribute sits at which offset in what format.
+// replaces hand written glVertexAttribPointer calls and drives the float to compressed format converters
+class VertexLayout
+{
+public:
+	// appends an attribute right after the previous one
+	VertexLayout& add(VertexSemantic semantic, unsigned int location, VertexFormat format);
+
+	// sets the attribute pointers of the bound VAO for the buffer bound to GL_ARRAY_BUFFER
+	void apply() const;
+
+	const VertexAttribute* find(VertexSemantic semantic) const;
+	const std::vector<VertexAttribute>& attributes() const { return attribs; }
+	unsigned int stride() const { return vertexStride; }
+
+	static unsigned int formatSize(VertexFormat format);
+	static unsigned int formatComponents(VertexFormat format);
+
+private:
+	std::vector<VertexAttribute> attribs;
+	unsigned int vertexStride = 0;
+};
+
+namespace VertexConvert {
+	uint16_t floatToHalf(float value);
+	uint16_t packUnorm16(float value);
+	// x, y, z as signed normalized 10 bit values, w = 0
+	uint32_t packSnorm1010102(float x, float y, float z);
+
+	// converts float vertices described by source (every attribute in a VERTEX_FLOAT format)
+	// into the formats of target, matching attributes by semantic. target semantics missing from source are zeroed
+	std::vector<uint8_t> convert(const float* vertices, unsigned int vertexCount, const VertexLayout& source, const VertexLayout& target);
+}
+
+#endif
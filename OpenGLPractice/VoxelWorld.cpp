@@ -0,0 +1,452 @@
+#include "VoxelWorld.h"
+#include "GLStateCache.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+	const int N = Chunk::SIZE;
+	const int P = VoxelMesher::PADDED_SIZE;
+	// visible chunks recorded per command list
+	const unsigned int CHUNKS_PER_LIST = 64;
+
+	// rounds towards negative infinity, so block -1 lands in chunk -1
+	int floorDiv(int value, int divisor) {
+		return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+	}
+
+	const ChunkCoord FACE_NEIGHBOURS[6] = {
+		{ -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }
+	};
+
+	ChunkCoord offset(const ChunkCoord& c, const ChunkCoord& by) {
+		return { c.x + by.x, c.y + by.y, c.z + by.z };
+	}
+}
+
+unsigned int VoxelMesher::greedyMesh(const std::vector<BlockID>& padded, const glm::vec3& origin, std::vector<float>& vertices) {
+	auto at = [&](const int pos[3]) { return padded[((pos[1] + 1) * P + (pos[2] + 1)) * P + (pos[0] + 1)]; };
+
+	// positive block ids face +d, negative ones -d
+	std::vector<int> mask(N * N);
+	unsigned int quads = 0;
+
+	for (int d = 0; d < 3; d++) {
+		int u = (d + 1) % 3, v = (d + 2) % 3;
+
+		// slice s is the plane between layer s - 1 and layer s along d
+		for (int s = 0; s <= N; s++) {
+			for (int j = 0; j < N; j++) {
+				for (int i = 0; i < N; i++) {
+					int pos[3];
+					pos[d] = s; pos[u] = i; pos[v] = j;
+					BlockID front = at(pos);
+					pos[d] = s - 1;
+					BlockID back = at(pos);
+
+					// a face belongs to the chunk owning its solid block, the neighbour draws its own
+					int face = 0;
+					if (back != BLOCK_AIR && front == BLOCK_AIR && s > 0)
+						face = back;
+					else if (front != BLOCK_AIR && back == BLOCK_AIR && s < N)
+						face = -(int)front;
+					mask[j * N + i] = face;
+				}
+			}
+
+			for (int j = 0; j < N; j++) {
+				for (int i = 0; i < N;) {
+					int face = mask[j * N + i];
+					if (face == 0) {
+						i++;
+						continue;
+					}
+
+					int w = 1;
+					while (i + w < N && mask[j * N + i + w] == face)
+						w++;
+					int h = 1;
+					for (; j + h < N; h++) {
+						bool rowMatches = true;
+						for (int k = 0; k < w && rowMatches; k++)
+							rowMatches = mask[(j + h) * N + i + k] == face;
+						if (!rowMatches)
+							break;
+					}
+
+					float corner[3], du[3] = { 0.0f, 0.0f, 0.0f }, dv[3] = { 0.0f, 0.0f, 0.0f };
+					corner[d] = origin[d] + s;
+					corner[u] = origin[u] + i;
+					corner[v] = origin[v] + j;
+					du[u] = (float)w;
+					dv[v] = (float)h;
+
+					auto vertex = [&](float a, float b) {
+						for (int axis = 0; axis < 3; axis++)
+							vertices.push_back(corner[axis] + du[axis] * a + dv[axis] * b);
+						vertices.push_back(w * a);
+						vertices.push_back(h * b);
+					};
+					// u x v points along +d, so this order is counter clockwise seen from +d
+					if (face > 0) {
+						vertex(0, 0); vertex(1, 0); vertex(1, 1);
+						vertex(0, 0); vertex(1, 1); vertex(0, 1);
+					}
+					else {
+						vertex(0, 0); vertex(1, 1); vertex(1, 0);
+						vertex(0, 0); vertex(0, 1); vertex(1, 1);
+					}
+					quads++;
+
+					for (int y = 0; y < h; y++)
+						for (int x = 0; x < w; x++)
+							mask[(j + y) * N + i + x] = 0;
+					i += w;
+				}
+			}
+		}
+	}
+	return quads;
+}
+
+VoxelWorld::VoxelWorld(ThreadPool& pool) : pool(pool), nextSerial(0), updateLimit(UINT_MAX), frameCounter(0), meshBytes(0), counters({ 0, 0, 0, 0, 0 })
+{
+}
+
+ChunkCoord VoxelWorld::chunkOf(int x, int y, int z) {
+	return { floorDiv(x, N), floorDiv(y, N), floorDiv(z, N) };
+}
+
+void VoxelWorld::generateTerrain(Chunk& chunk) {
+	chunk.blocks.assign(Chunk::VOLUME, BLOCK_AIR);
+
+	for (int z = 0; z < N; z++) {
+		for (int x = 0; x < N; x++) {
+			float worldX = (float)(chunk.coord.x * N + x), worldZ = (float)(chunk.coord.z * N + z);
+			float height = -6.0f + 3.0f * std::sin(worldX * 0.09f) + 2.0f * std::cos(worldZ * 0.07f) + 1.5f * std::sin((worldX + worldZ) * 0.05f);
+			int top = (int)std::floor(height);
+
+			for (int y = 0; y < N; y++) {
+				int worldY = chunk.coord.y * N + y;
+				if (worldY > top)
+					break;
+				chunk.set(x, y, z, worldY == top ? BLOCK_GRASS : worldY > top - 3 ? BLOCK_DIRT : BLOCK_STONE);
+			}
+		}
+	}
+}
+
+void VoxelWorld::createChunk(const ChunkCoord& coord) {
+	Chunk chunk;
+	chunk.coord = coord;
+	generateTerrain(chunk);
+	insertChunk(std::move(chunk));
+}
+
+void VoxelWorld::insertChunk(Chunk&& chunk) {
+	ChunkCoord coord = chunk.coord;
+	std::unique_ptr<Entry>& slot = chunks[coord];
+	if (slot)
+		release(*slot);
+	slot.reset(new Entry());
+
+	Entry& entry = *slot;
+	entry.chunk = std::move(chunk);
+	entry.serial = nextSerial++;
+	entry.VAO = entry.VBO = 0;
+	entry.vertexCount = 0;
+	entry.quads = 0;
+	entry.gpuBytes = 0;
+	entry.lastDrawn = frameCounter;
+	entry.dirty = true;
+	entry.meshing = false;
+	entry.meshReleased = false;
+
+	// their border faces against this chunk are hidden now
+	for (const ChunkCoord& by : FACE_NEIGHBOURS)
+		markDirty(offset(coord, by));
+}
+
+void VoxelWorld::removeChunk(const ChunkCoord& coord) {
+	auto found = chunks.find(coord);
+	if (found == chunks.end())
+		return;
+	release(*found->second);
+	chunks.erase(found);
+
+	for (const ChunkCoord& by : FACE_NEIGHBOURS)
+		markDirty(offset(coord, by));
+}
+
+void VoxelWorld::releaseMesh(const ChunkCoord& coord) {
+	auto found = chunks.find(coord);
+	if (found == chunks.end() || found->second->VAO == 0)
+		return;
+	release(*found->second);
+	found->second->meshReleased = true;
+}
+
+void VoxelWorld::chunkInfo(std::vector<ChunkInfo>& info) const {
+	info.clear();
+	for (const auto& pair : chunks)
+		info.push_back({ pair.first, pair.second->lastDrawn, pair.second->gpuBytes });
+}
+
+BlockID VoxelWorld::getBlock(int x, int y, int z) const {
+	auto found = chunks.find(chunkOf(x, y, z));
+	if (found == chunks.end())
+		return BLOCK_AIR;
+	const ChunkCoord& c = found->first;
+	return found->second->chunk.get(x - c.x * N, y - c.y * N, z - c.z * N);
+}
+
+void VoxelWorld::setBlock(int x, int y, int z, BlockID block) {
+	ChunkCoord coord = chunkOf(x, y, z);
+	auto found = chunks.find(coord);
+	if (found == chunks.end())
+		return;
+
+	int local[3] = { x - coord.x * N, y - coord.y * N, z - coord.z * N };
+	Entry& entry = *found->second;
+	if (entry.chunk.get(local[0], local[1], local[2]) == block)
+		return;
+	entry.chunk.set(local[0], local[1], local[2], block);
+	entry.dirty = true;
+
+	// a block on the border also decides whether the neighbour shows the face against it
+	for (int axis = 0; axis < 3; axis++) {
+		ChunkCoord by = { 0, 0, 0 };
+		int* component = axis == 0 ? &by.x : axis == 1 ? &by.y : &by.z;
+		if (local[axis] == 0)
+			*component = -1;
+		else if (local[axis] == N - 1)
+			*component = 1;
+		if (*component != 0)
+			markDirty(offset(coord, by));
+	}
+}
+
+void VoxelWorld::markDirty(const ChunkCoord& coord) {
+	auto found = chunks.find(coord);
+	if (found != chunks.end())
+		found->second->dirty = true;
+}
+
+// Amanatides and Woo voxel traversal
+bool VoxelWorld::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec3& hit, glm::ivec3& before) const {
+	int cell[3], step[3];
+	float tMax[3], tDelta[3];
+	for (int axis = 0; axis < 3; axis++) {
+		cell[axis] = (int)std::floor(origin[axis]);
+		float dir = direction[axis];
+		step[axis] = dir > 0.0f ? 1 : dir < 0.0f ? -1 : 0;
+		tDelta[axis] = step[axis] != 0 ? std::fabs(1.0f / dir) : 1e30f;
+		float boundary = step[axis] > 0 ? cell[axis] + 1.0f - origin[axis] : origin[axis] - cell[axis];
+		tMax[axis] = step[axis] != 0 ? boundary * tDelta[axis] : 1e30f;
+	}
+
+	before = glm::ivec3(cell[0], cell[1], cell[2]);
+	float t = 0.0f;
+	while (t <= maxDistance) {
+		if (getBlock(cell[0], cell[1], cell[2]) != BLOCK_AIR) {
+			hit = glm::ivec3(cell[0], cell[1], cell[2]);
+			return true;
+		}
+		before = glm::ivec3(cell[0], cell[1], cell[2]);
+
+		int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+		cell[axis] += step[axis];
+		t = tMax[axis];
+		tMax[axis] += tDelta[axis];
+	}
+	return false;
+}
+
+void VoxelWorld::copyPadded(const Entry& entry, std::vector<BlockID>& padded) const {
+	const ChunkCoord& coord = entry.chunk.coord;
+
+	const Chunk* neighbours[27];
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				auto found = chunks.find({ coord.x + dx, coord.y + dy, coord.z + dz });
+				neighbours[((dy + 1) * 3 + (dz + 1)) * 3 + (dx + 1)] = found != chunks.end() ? &found->second->chunk : nullptr;
+			}
+		}
+	}
+
+	// missing neighbours read as air, their faces appear once the neighbour loads and marks this chunk dirty
+	padded.assign(P * P * P, BLOCK_AIR);
+	auto split = [](int p, int& local) {
+		int value = p - 1;
+		if (value < 0) { local = value + N; return 0; }
+		if (value >= N) { local = value - N; return 2; }
+		local = value;
+		return 1;
+	};
+	for (int py = 0; py < P; py++) {
+		int ly, cy = split(py, ly);
+		for (int pz = 0; pz < P; pz++) {
+			int lz, cz = split(pz, lz);
+			for (int px = 0; px < P; px++) {
+				int lx, cx = split(px, lx);
+				const Chunk* source = neighbours[(cy * 3 + cz) * 3 + cx];
+				if (source)
+					padded[(py * P + pz) * P + px] = source->get(lx, ly, lz);
+			}
+		}
+	}
+}
+
+void VoxelWorld::update() {
+	std::vector<FinishedMesh> done;
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		done.swap(finished);
+	}
+
+	// whatever is over the limit waits for the next update
+	if (done.size() > updateLimit) {
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		for (size_t i = updateLimit; i < done.size(); i++)
+			finished.push_back(std::move(done[i]));
+		done.resize(updateLimit);
+	}
+
+	counters.uploadedLastUpdate = 0;
+	for (FinishedMesh& mesh : done) {
+		auto found = chunks.find(mesh.coord);
+		// the chunk was unloaded (and maybe loaded again) while its mesh was being built
+		if (found == chunks.end() || found->second->serial != mesh.serial)
+			continue;
+		Entry& entry = *found->second;
+		entry.meshing = false;
+		entry.meshReleased = false;
+		entry.quads = mesh.quads;
+		upload(entry, mesh.vertices);
+		counters.uploadedLastUpdate++;
+	}
+
+	// one job per chunk at a time, an edit during meshing leaves it dirty for the next round
+	counters.meshing = 0;
+	counters.quads = 0;
+	unsigned int started = 0;
+	for (auto& pair : chunks) {
+		Entry& entry = *pair.second;
+		counters.quads += entry.quads;
+		if (entry.dirty && !entry.meshing && started < updateLimit) {
+			started++;
+			entry.dirty = false;
+			entry.meshing = true;
+
+			std::vector<BlockID> padded;
+			copyPadded(entry, padded);
+			ChunkCoord coord = entry.chunk.coord;
+			unsigned int serial = entry.serial;
+			glm::vec3 origin((float)(coord.x * N), (float)(coord.y * N), (float)(coord.z * N));
+
+			pool.submit([this, padded = std::move(padded), coord, serial, origin]() {
+				FinishedMesh mesh;
+				mesh.coord = coord;
+				mesh.serial = serial;
+				mesh.quads = VoxelMesher::greedyMesh(padded, origin, mesh.vertices);
+
+				std::lock_guard<std::mutex> lock(finishedMutex);
+				finished.push_back(std::move(mesh));
+			});
+		}
+		if (entry.meshing)
+			counters.meshing++;
+	}
+	counters.chunks = (unsigned int)chunks.size();
+}
+
+void VoxelWorld::upload(Entry& entry, const std::vector<float>& vertices) {
+	if (entry.VAO == 0) {
+		glGenVertexArrays(1, &entry.VAO);
+		glGenBuffers(1, &entry.VBO);
+
+		glState.bindVertexArray(entry.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, entry.VBO);
+		VertexLayout layout;
+		layout.add(SEMANTIC_POSITION, 0, VERTEX_FLOAT3).add(SEMANTIC_TEXCOORD, 1, VERTEX_FLOAT2);
+		layout.apply();
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, entry.VBO);
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	entry.vertexCount = (GLsizei)(vertices.size() / 5);
+
+	meshBytes -= entry.gpuBytes;
+	entry.gpuBytes = vertices.size() * sizeof(float);
+	meshBytes += entry.gpuBytes;
+}
+
+void VoxelWorld::draw(const Frustum& frustum) {
+	drawable.clear();
+	bounds.clear();
+	for (auto& pair : chunks) {
+		Entry& entry = *pair.second;
+		if (entry.vertexCount == 0 && !entry.meshReleased)
+			continue;
+		const ChunkCoord& c = pair.first;
+		glm::vec3 min((float)(c.x * N), (float)(c.y * N), (float)(c.z * N));
+		bounds.add(min, min + glm::vec3((float)N));
+		drawable.push_back(&entry);
+	}
+
+	visible.clear();
+	FrustumCulling::cull(frustum, bounds, visible);
+
+	// every list covers its own run of visible chunks, so no two workers touch the same entry
+	drawLists.resize((visible.size() + CHUNKS_PER_LIST - 1) / CHUNKS_PER_LIST);
+	recordInParallel(pool, drawLists, [this](CommandList& list, unsigned int l) {
+		list.clear();
+		size_t end = std::min(visible.size(), (size_t)(l + 1) * CHUNKS_PER_LIST);
+		for (size_t v = (size_t)l * CHUNKS_PER_LIST; v < end; v++) {
+			Entry& entry = *drawable[visible[v]];
+			entry.lastDrawn = frameCounter;
+			// back in view after its mesh was evicted
+			if (entry.meshReleased) {
+				entry.meshReleased = false;
+				entry.dirty = true;
+				continue;
+			}
+			list.bindVertexArray(entry.VAO);
+			list.drawArrays(GL_TRIANGLES, 0, entry.vertexCount);
+		}
+	});
+
+	counters.drawnLastFrame = 0;
+	for (const CommandList& list : drawLists) {
+		list.execute();
+		// a bind and a draw per chunk
+		counters.drawnLastFrame += list.commandCount() / 2;
+	}
+	frameCounter++;
+}
+
+void VoxelWorld::release(Entry& entry) {
+	if (entry.VAO) {
+		glState.deleteVertexArray(entry.VAO);
+		glDeleteBuffers(1, &entry.VBO);
+		entry.VAO = entry.VBO = 0;
+	}
+	entry.vertexCount = 0;
+	meshBytes -= entry.gpuBytes;
+	entry.gpuBytes = 0;
+}
+
+void VoxelWorld::discard() {
+	// queued jobs still point at this world
+	pool.wait();
+	for (auto& pair : chunks)
+		release(*pair.second);
+	chunks.clear();
+	finished.clear();
+}
@@ -0,0 +1,162 @@
+#ifndef VOXEL_WORLD_H
+#define VOXEL_WORLD_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "glm\glm\glm.hpp"
+#include "CommandList.h"
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+
+typedef uint8_t BlockID;
+const BlockID BLOCK_AIR = 0;
+const BlockID BLOCK_GRASS = 1;
+const BlockID BLOCK_DIRT = 2;
+const BlockID BLOCK_STONE = 3;
+
+struct ChunkCoord {
+	int x, y, z;
+
+	bool operator==(const ChunkCoord& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct ChunkCoordHash {
+	size_t operator()(const ChunkCoord& c) const {
+		return ((size_t)(unsigned int)c.x * 73856093u) ^ ((size_t)(unsigned int)c.y * 19349663u) ^ ((size_t)(unsigned int)c.z * 83492791u);
+	}
+};
+
+// 32 blocks a side, x fastest then z then y
+struct Chunk {
+	static const int SIZE = 32;
+	static const int VOLUME = SIZE * SIZE * SIZE;
+
+	ChunkCoord coord;
+	std::vector<BlockID> blocks;
+
+	static int index(int x, int y, int z) { return (y * SIZE + z) * SIZE + x; }
+	BlockID get(int x, int y, int z) const { return blocks[index(x, y, z)]; }
+	void set(int x, int y, int z, BlockID block) { blocks[index(x, y, z)] = block; }
+};
+
+namespace VoxelMesher {
+	const int PADDED_SIZE = Chunk::SIZE + 2;
+
+	// padded holds the chunk plus one layer of its neighbours (PADDED_SIZE cubed, same order as Chunk), so faces against
+	// solid neighbours are dropped too. faces between air and a block of the chunk are merged into the largest rectangles
+	// of one block type per slice and appended as world space triangles, position (3 floats) and texture coordinates (2 floats)
+	// repeating once per block. returns the number of quads
+	unsigned int greedyMesh(const std::vector<BlockID>& padded, const glm::vec3& origin, std::vector<float>& vertices);
+}
+
+// a world of chunks that are meshed on worker threads.
+// editing a block marks its chunk dirty (and the neighbour when the block is on the border), update() hands a copy of every
+// dirty chunk to the pool and uploads the meshes that came back, so only edited chunks are ever remeshed.
+// each chunk is drawn with one glDrawArrays using the world space layout of staticVertexShader.vs. the chunks in view are walked
+// and their draws recorded into command lists on the pool, the GL thread only replays the lists
+class VoxelWorld
+{
+public:
+	struct Stats {
+		unsigned int chunks;
+		unsigned int meshing;
+		unsigned int uploadedLastUpdate;
+		unsigned int drawnLastFrame;
+		unsigned int quads;
+	};
+
+	// what the streamer needs to pick chunks for eviction
+	struct ChunkInfo {
+		ChunkCoord coord;
+		// frame the chunk was last inside the frustum
+		unsigned int lastDrawn;
+		size_t gpuBytes;
+	};
+
+	VoxelWorld(ThreadPool& pool);
+
+	// fills a chunk from the terrain function, replacing whatever was there
+	void createChunk(const ChunkCoord& coord);
+	// takes over a chunk that was filled elsewhere, replacing whatever was at its coordinate
+	void insertChunk(Chunk&& chunk);
+	void removeChunk(const ChunkCoord& coord);
+	bool hasChunk(const ChunkCoord& coord) const { return chunks.count(coord) != 0; }
+	// frees the mesh but keeps the blocks, the chunk is meshed again once it comes into view
+	void releaseMesh(const ChunkCoord& coord);
+
+	// blocks outside of loaded chunks read as air and ignore writes
+	BlockID getBlock(int x, int y, int z) const;
+	void setBlock(int x, int y, int z, BlockID block);
+
+	// steps through the blocks along the ray, hit is the first solid one and before the empty one in front of it
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec3& hit, glm::ivec3& before) const;
+
+	// starts meshing dirty chunks and uploads finished meshes, main thread only
+	void update();
+	// draws the chunks inside the frustum with the bound program and textures
+	void draw(const Frustum& frustum);
+	void discard();
+
+	// meshes uploaded and meshing jobs started per update, so a burst of new chunks is spread over frames
+	void setUpdateLimit(unsigned int chunksPerUpdate) { updateLimit = chunksPerUpdate; }
+
+	const Stats& stats() const { return counters; }
+	unsigned int frame() const { return frameCounter; }
+	size_t cpuBytes() const { return chunks.size() * sizeof(BlockID) * Chunk::VOLUME; }
+	size_t gpuBytes() const { return meshBytes; }
+	void chunkInfo(std::vector<ChunkInfo>& info) const;
+
+	// deterministic height map terrain, safe to call from any thread
+	static void generateTerrain(Chunk& chunk);
+	static ChunkCoord chunkOf(int x, int y, int z);
+
+private:
+	struct Entry {
+		Chunk chunk;
+		unsigned int serial;
+		unsigned int VAO;
+		unsigned int VBO;
+		GLsizei vertexCount;
+		unsigned int quads;
+		size_t gpuBytes;
+		unsigned int lastDrawn;
+		bool dirty;
+		bool meshing;
+		bool meshReleased;
+	};
+
+	struct FinishedMesh {
+		ChunkCoord coord;
+		unsigned int serial;
+		std::vector<float> vertices;
+		unsigned int quads;
+	};
+
+	ThreadPool& pool;
+	std::unordered_map<ChunkCoord, std::unique_ptr<Entry>, ChunkCoordHash> chunks;
+	unsigned int nextSerial;
+	unsigned int updateLimit;
+	unsigned int frameCounter;
+	size_t meshBytes;
+
+	std::mutex finishedMutex;
+	std::vector<FinishedMesh> finished;
+
+	AABBList bounds;
+	std::vector<Entry*> drawable;
+	std::vector<unsigned int> visible;
+	std::vector<CommandList> drawLists;
+	Stats counters;
+
+	void markDirty(const ChunkCoord& coord);
+	void copyPadded(const Entry& entry, std::vector<BlockID>& padded) const;
+	void upload(Entry& entry, const std::vector<float>& vertices);
+	void release(Entry& entry);
+};
+
+#endif
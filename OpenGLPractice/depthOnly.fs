@@ -0,0 +1,6 @@
+#version 330 core
+
+// fragment shader of the depth pre-pass, colour writes are off so it only has to exist
+void main()
+{
+}
\ No newline at end of file
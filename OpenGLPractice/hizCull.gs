@@ -0,0 +1,19 @@
+#version 330 core
+
+// keeps the instances the vertex shader found visible, transform feedback writes their matrices out back to back
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in mat4 vModel[];
+flat in int vVisible[];
+
+out mat4 outModel;
+
+void main()
+{
+	if (vVisible[0] != 0) {
+		outModel = vModel[0];
+		EmitVertex();
+		EndPrimitive();
+	}
+}
\ No newline at end of file
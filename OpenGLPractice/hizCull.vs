@@ -0,0 +1,74 @@
+#version 330 core
+
+// one point per instance, the model matrix takes up locations 0 to 3
+layout (location = 0) in mat4 aModel;
+
+// box of the mesh in model space, shared by every instance
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+uniform mat4 viewProj;
+// the matrix the pyramid was rendered with, so the box lands where its depth was written
+uniform mat4 occlusionViewProj;
+uniform bool occlusionValid;
+uniform sampler2D hiZ;
+uniform int pyramidLevels;
+
+out mat4 vModel;
+flat out int vVisible;
+
+vec3 corner(int i) {
+	return vec3((i & 4) != 0 ? boundsMax.x : boundsMin.x, (i & 2) != 0 ? boundsMax.y : boundsMin.y, (i & 1) != 0 ? boundsMax.z : boundsMin.z);
+}
+
+bool insideFrustum() {
+	mat4 mvp = viewProj * aModel;
+	// outside when all eight corners are beyond the same clip plane
+	ivec3 below = ivec3(0), above = ivec3(0);
+	for (int i = 0; i < 8; i++) {
+		vec4 clip = mvp * vec4(corner(i), 1.0);
+		below += ivec3(lessThan(clip.xyz, vec3(-clip.w)));
+		above += ivec3(greaterThan(clip.xyz, vec3(clip.w)));
+	}
+	return !any(equal(below, ivec3(8))) && !any(equal(above, ivec3(8)));
+}
+
+bool passesHiZ() {
+	mat4 mvp = occlusionViewProj * aModel;
+	vec3 ndcMin = vec3(1.0), ndcMax = vec3(-1.0);
+	for (int i = 0; i < 8; i++) {
+		vec4 clip = mvp * vec4(corner(i), 1.0);
+		// crossing the near plane, nothing to compare against
+		if (clip.w <= 0.0)
+			return true;
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+
+	vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+	float nearest = ndcMin.z * 0.5 + 0.5;
+
+	// the level where the rectangle spans at most two texels each way, four fetches then cover all of it
+	vec2 extent = (uvMax - uvMin) * vec2(textureSize(hiZ, 0));
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, pyramidLevels - 1);
+	ivec2 size = textureSize(hiZ, level);
+	ivec2 texelMin = min(ivec2(uvMin * vec2(size)), size - 1);
+	ivec2 texelMax = min(ivec2(uvMax * vec2(size)), size - 1);
+	if (any(greaterThan(texelMax - texelMin, ivec2(1))) && level < pyramidLevels - 1) {
+		level++;
+		size = textureSize(hiZ, level);
+		texelMin = min(ivec2(uvMin * vec2(size)), size - 1);
+		texelMax = min(ivec2(uvMax * vec2(size)), size - 1);
+	}
+
+	float farthest = max(max(texelFetch(hiZ, texelMin, level).r, texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), level).r),
+		max(texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(hiZ, texelMax, level).r));
+	return nearest <= farthest;
+}
+
+void main(){
+	vModel = aModel;
+	vVisible = (insideFrustum() && (!occlusionValid || passesHiZ())) ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+
+// one level of the hi-z pyramid, every texel keeps the farthest depth of the texels it covers in the level above.
+// the caller restricts the source to that single level, so lod 0 is always the right one
+uniform sampler2D source;
+
+layout (location = 0) out float farthest;
+
+void main()
+{
+	ivec2 sourceSize = textureSize(source, 0);
+	ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+
+	// halving an odd size leaves one row or column over, the last texel takes it too
+	int lastX = (base.x + 3 == sourceSize.x) ? 2 : 1;
+	int lastY = (base.y + 3 == sourceSize.y) ? 2 : 1;
+
+	farthest = 0.0;
+	for (int y = 0; y <= lastY; y++)
+		for (int x = 0; x <= lastX; x++)
+			farthest = max(farthest, texelFetch(source, min(base + ivec2(x, y), sourceSize - 1), 0).r);
+}
\ No newline at end of file
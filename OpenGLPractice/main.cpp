@@ -1,31 +1,111 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 #include "shader.h"
 #include "stb_image.h"
 #include "Camera.h"
+#include "BatchRenderer.h"
+#include "GLStateCache.h"
+#include "CameraUniforms.h"
+#include "VertexLayout.h"
+#include "DepthPrepass.h"
+#include "FrustumCulling.h"
+#include "BVH.h"
+#include "OcclusionBuffer.h"
+#include "HiZCulling.h"
+#include "LevelOfDetail.h"
+#include "FrameGraph.h"
+#include "StaticBatch.h"
+#include "MeshOptimizer.h"
+#include "VoxelWorld.h"
+#include "ChunkStreamer.h"
+#include "TransformStore.h"
+#include "TransformHierarchy.h"
+#include "InputAccumulator.h"
+#include "FixedTimestep.h"
+#include "AffineTransform.h"
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow* window);
+void processInput(GLFWwindow* window, const InputFrame& frame);
+void simulate(const InputFrame& frame, float dt);
 void mouse_callback(GLFWwindow* window, double posX, double posY);
 void scroll_callback(GLFWwindow* window, double posX, double posY);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 float mixVal = 0.2f;
+bool depthPrepassEnabled = true;
+bool gpuCullingEnabled = false;
+bool wallGateOpen = false;
 
 float WHeight = 600.0f;
 float WWidth = 800.0f;
 
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
-float lastX = WWidth / 2.0f;
-float lastY = WHeight / 2.0f;
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
-bool firstMouse = true;
-
+//the callbacks only collect input here, it is applied to the camera once per frame
+InputAccumulator input;
+
+
+int main(int argc, char* argv[]) {
+	//runs the CPU side benchmarks instead of opening a window
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+		CullBenchmarkResult cull = FrustumCulling::benchmark(100000, 50);
+		std::cout << "frustum culling " << cull.boxCount << " boxes (" << cull.visibleCount << " visible): scalar " << cull.scalarMs
+			<< " ms, SSE " << cull.sseMs << " ms, AVX2 " << cull.avx2Ms << " ms, results " << (cull.resultsMatch ? "match" : "DIFFER") << std::endl;
+
+		LODBenchmarkResult lod = LevelOfDetail::benchmark(100000);
+		std::cout << "level of detail, " << lod.objectCount << " spheres:" << std::endl;
+		for (const LODBenchmarkSample& sample : lod.samples)
+			std::cout << "  distance " << sample.distance << ": " << sample.lodTriangles << " triangles (" << sample.fullTriangles
+				<< " at full detail), selected in " << sample.selectMs << " ms" << std::endl;
+		std::cout << "  level switches while wobbling: " << lod.switchesWithHysteresis << " with hysteresis, "
+			<< lod.switchesWithoutHysteresis << " without" << std::endl;
+
+		TransformBenchmarkResult transforms = TransformKernels::benchmark(100000, 20);
+		std::cout << "transforms, " << transforms.objectCount << " objects: models glm " << transforms.glmModelMs << " ms, SoA scalar "
+			<< transforms.scalarModelMs << " ms, SoA SSE " << transforms.sseModelMs << " ms; MVPs glm " << transforms.glmMVPMs
+			<< " ms, SoA SSE " << transforms.sseMVPMs << " ms; max difference " << transforms.maxError << std::endl;
+
+		ThreadPool benchWorkers;
+		HierarchyBenchmarkResult hierarchy = TransformHierarchyBenchmark::run(benchWorkers, 300, 5, 20);
+		std::cout << "transform hierarchy, " << hierarchy.nodeCount << " nodes " << hierarchy.depth << " deep: everything moved "
+			<< hierarchy.allDirtyMs << " ms (" << hierarchy.allDirtyParallelMs << " ms on " << benchWorkers.threadCount() + 1
+			<< " threads), one subtree moved " << hierarchy.oneSubtreeMs << " ms, nothing moved " << hierarchy.cleanMs << " ms" << std::endl;
+
+		AffineBenchmarkResult affine = AffineTransformBenchmark::run(100000, 20);
+		std::cout << "compose and invert, " << affine.transformCount << " pairs: mat4 " << affine.mat4Ms << " ms, translation "
+			<< affine.translationMs << " ms, rigid " << affine.rigidMs << " ms, uniform scale " << affine.uniformScaleMs << " ms, general 3x4 "
+			<< affine.generalMs << " ms; max difference " << affine.maxError << std::endl;
+
+		BVHBenchmarkResult bvh = BVHBenchmark::run(20000, 200);
+		std::cout << "bvh over " << bvh.boxCount << " boxes built in " << bvh.buildMs << " ms, " << bvh.rayCount << " rays (" << bvh.hits
+			<< " hits): bvh " << bvh.bvhRaysMs << " ms, every box " << bvh.bruteForceRaysMs << " ms, results "
+			<< (bvh.resultsMatch ? "match" : "DIFFER") << "; " << bvh.moveRounds << " rounds moving " << bvh.movedPerRound << " boxes: refit "
+			<< bvh.refitMs << " ms per round, " << bvh.rebuilds << " rebuilds, results " << (bvh.movedResultsMatch ? "match" : "DIFFER") << std::endl;
+
+		MeshBenchmarkResult mesh = MeshOptimizer::benchmark(64);
+		auto printMesh = [](const char* name, const MeshOptimizeReport& report) {
+			std::cout << "  " << name << ": " << report.verticesBefore << " vertices welded to " << report.verticesAfter << ", ACMR/ATVR unindexed "
+				<< report.before.ACMR << "/" << report.before.ATVR << ", welded " << report.welded.ACMR << "/" << report.welded.ATVR
+				<< ", optimized " << report.after.ACMR << "/" << report.after.ATVR << std::endl;
+		};
+		std::cout << "vertex cache optimization, " << MeshOptimizer::CACHE_SIZE << " entry cache, " << mesh.gridSize << "x" << mesh.gridSize
+			<< " grid optimized in " << mesh.gridOptimizeMs << " ms:" << std::endl;
+		printMesh("grid", mesh.grid);
+		printMesh("sphere", mesh.sphere);
+
+		TimestepBenchmarkResult timestep = FixedTimestepBenchmark::run(60.0, 60.0f);
+		std::cout << "fixed timestep, " << timestep.stepCount << " steps (" << timestep.simulatedSeconds << " s): results at 30/144/jittery fps "
+			<< (timestep.fixedStepsMatch ? "identical" : "DIFFER") << ", with the frame time as step they are up to "
+			<< timestep.variableStepSpread << " apart; " << timestep.msPerStep << " ms per step" << std::endl;
+		return 0;
+	}
 
-int main() {
 	//initializes glfw
 	glfwInit();
 	//sets major version, minor version, and profile type of OpenGL
@@ -48,6 +128,7 @@ int main() {
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetScrollCallback(window, scroll_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
+	glfwSetKeyCallback(window, key_callback);
 
 	//it declares the current window as the context of openGL
 	glfwMakeContextCurrent(window);
@@ -59,6 +140,9 @@ int main() {
 	}
 
 	//sets viewport of openGL
+	int startWidth, startHeight;
+	glfwGetFramebufferSize(window, &startWidth, &startHeight);
+	camera.SetViewport(startWidth, startHeight);
 
 	//--------------------------------------------------------------------
 	//-------------------------------------------------------------------
@@ -114,10 +198,6 @@ int main() {
 		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
 		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
 	};
-	int indices[] = {
-		0, 1, 3, //first triangle
-		1, 2, 3  //second traingle
-	};
 
 	//-----------------------------------------------------------------------------------
 	//-----------------------------------------------------------------------------------
@@ -125,7 +205,7 @@ int main() {
 	// create a vertex array object that stores vertex attrib pointers and vertex buffer objects associated with it
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO); // generates a vertex array and stores unique ID in VAO that defines it
-	glBindVertexArray(VAO); // binds the VAO to the state variable in openGL
+	glState.bindVertexArray(VAO); // binds the VAO to the state variable in openGL
 
 	//-----------------------------------------------------------------------------------
 	//-----------------------------------------------------------------------------------
@@ -136,34 +216,55 @@ int main() {
 	glGenBuffers(1, &VBO); // Generates a buffer and stores unique ID in VBO that defines it
 	glBindBuffer(GL_ARRAY_BUFFER, VBO); // Binds the VBO to the ARRAY BUFFER state variable in openGL
 
-	// Stores data in the VBO from the vertices array defined above
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	// the float vertices above are packed into half float positions and 16 bit texture coordinates,
+	// 12 bytes per vertex instead of 20
+	VertexLayout floatLayout;
+	floatLayout.add(SEMANTIC_POSITION, 0, VERTEX_FLOAT3).add(SEMANTIC_TEXCOORD, 1, VERTEX_FLOAT2);
+	VertexLayout packedLayout;
+	packedLayout.add(SEMANTIC_POSITION, 0, VERTEX_HALF4).add(SEMANTIC_TEXCOORD, 1, VERTEX_UNORM16_2);
+
+	// a sphere in several detail levels goes in the same buffer, right after the cube
+	std::vector<float> meshVertices(vertices, vertices + sizeof(vertices) / sizeof(float));
+	LODMesh sphereMesh = LevelOfDetail::appendSphere(meshVertices, { 48, 24, 12, 6 });
+
+	// every mesh is welded and reordered for the post-transform cache, from here on first and count are index ranges
+	IndexedMesh sharedMesh;
+	sharedMesh.floatsPerVertex = 5;
+	GLint cubeFirst = (GLint)MeshOptimizer::appendOptimized(sharedMesh, vertices, 36);
+	GLsizei cubeCount = (GLsizei)sharedMesh.indices.size() - cubeFirst;
+	for (LODLevel& level : sphereMesh.levels) {
+		unsigned int firstIndex = MeshOptimizer::appendOptimized(sharedMesh, &meshVertices[level.first * 5], level.count);
+		level.first = (GLint)firstIndex;
+		level.count = (GLsizei)sharedMesh.indices.size() - level.first;
+	}
+
+	std::vector<uint8_t> packedVertices = VertexConvert::convert(sharedMesh.vertices.data(), sharedMesh.vertexCount(), floatLayout, packedLayout);
+
+	// Stores data in the VBO from the packed vertices
+	glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
 
 	//-----------------------------------------------------------------------------------
 	//-----------------------------------------------------------------------------------
 										//EBO//
-	/*unsigned int EBO;
+	unsigned int EBO;
 	glGenBuffers(1, &EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); // the VAO remembers the element buffer bound while it is bound
 
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);*/
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sharedMesh.indices.size() * sizeof(unsigned int), sharedMesh.indices.data(), GL_STATIC_DRAW);
 
 
 	//-----------------------------------------------------------------------------------
 	//-----------------------------------------------------------------------------------
 											//VERTEX ATTRIBS//
 	// specifies the vertex attributes (specified in the vertex shader) of the vertex data given in the VBO
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+	packedLayout.apply();
 
 
 
 	//-----------------------------------------------------------------------------------
 	//-----------------------------------------------------------------------------------
 											//UNBINDING VAO AND VBO//
-	glBindVertexArray(0);
+	glState.bindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbinding this does not effect the program because VAO remembers the VBO associated with it
 
 	//-----------------------------------------------------------------------------------
@@ -173,7 +274,7 @@ int main() {
 	//TEXTURE 1
 	unsigned int texture1, texture2;
 	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
+	glState.bindTextureForEdit(0, texture1);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -197,7 +298,7 @@ int main() {
 
 	//TEXTURE 2
 	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
+	glState.bindTextureForEdit(0, texture2);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -238,7 +339,135 @@ int main() {
 		glm::vec3(0.0f,  0.0f, -9.0f)
 	};
 
-	glEnable(GL_DEPTH_TEST);
+	//-----------------------------------------------------------------------------------
+	//-----------------------------------------------------------------------------------
+											//BATCHING//
+	// every cube is static, so the model matrices and a BVH over the bounding boxes of the grid are built once.
+	// each frame only the cubes the BVH finds inside the view frustum, and that are not hidden behind nearer cubes, are queued into the batch renderer,
+	// which draws them with one call per material
+	BatchRenderer batch(VAO);
+	unsigned int containerMaterial = batch.addMaterial(&ourShader, { texture1, texture2 });
+
+	//each original cube is a root of the transform hierarchy and the containers stacked above and beside it are its children,
+	//so moving an original carries its whole row along. world matrices are rebuilt only below what moved
+	TransformHierarchy cubeHierarchy;
+	std::vector<unsigned int> cubeNodes;
+	for (unsigned int i = 0; i < 10; i++) {
+		float xvalue = 0.0f;
+
+		float angle = 0.0f;
+		unsigned int original = cubeHierarchy.add(TransformHierarchy::NO_PARENT, cubePositions[i], glm::angleAxis(glm::radians(angle), glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f))));
+		cubeNodes.push_back(original);
+
+		for (unsigned int j = 0; j < 32; j++) {
+
+			//creating more containgers above the originals and fake
+			cubeNodes.push_back(cubeHierarchy.add(original, glm::vec3(0.0f + xvalue, 1.0f, 0.0f)));
+			xvalue += 1.0f;
+
+			//creating more containers on the side of the original
+			cubeNodes.push_back(cubeHierarchy.add(original, glm::vec3(0.0f + xvalue, 0.0f, 0.0f)));
+		}
+	}
+	cubeHierarchy.update();
+
+	std::vector<glm::mat4> cubeModels;
+	std::vector<glm::vec3> cubeMins, cubeMaxs;
+	for (unsigned int node : cubeNodes) {
+		const glm::mat4& model = cubeHierarchy.world(node);
+		glm::vec3 center = glm::vec3(model[3]);
+		cubeModels.push_back(model);
+		cubeMins.push_back(center - glm::vec3(0.5f));
+		cubeMaxs.push_back(center + glm::vec3(0.5f));
+	}
+
+	//a row of spheres running off into the distance, each drawn with the level its size on screen needs
+	TransformStore sphereTransforms;
+	std::vector<glm::mat4> sphereModels;
+	std::vector<unsigned int> sphereLevels;
+	const float SPHERE_SCALE = 2.0f;
+	for (unsigned int i = 0; i < 24; i++) {
+		sphereTransforms.add(glm::vec3(-4.0f, 1.0f, -4.0f - i * 8.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(SPHERE_SCALE));
+		sphereLevels.push_back(0);
+	}
+	sphereTransforms.computeModels(sphereModels);
+	LODSelector lodSelector;
+
+	//camera matrices live in one uniform buffer shared by every shader
+	CameraUniforms cameraUniforms;
+
+	//lays down depth first so the two texture fragment shader only runs once per pixel
+	DepthPrepass prepass("vertexShader.vs", "depthOnly.fs");
+
+	//orders the render passes of a frame and hands out their render targets from a pool
+	FrameGraph frameGraph;
+
+	BVH cubeBVH;
+	cubeBVH.build(cubeMins, cubeMaxs);
+	std::vector<unsigned int> visibleCubes, lastVisibleCubes;
+
+	//the grid does not move, so the cpu culling, the sphere levels and the camera block only have to be redone when the camera changed
+	unsigned int cpuCullVersion = 0, lodVersion = 0, uploadedCameraVersion = 0;
+	bool batchQueued = false;
+	bool hiZActive = false;
+
+	//the nearest cubes in view are rasterized on the cpu as occluders, whatever they fully hide is never queued
+	const unsigned int OCCLUDER_COUNT = 32;
+	OcclusionBuffer occlusion;
+	std::vector<unsigned int> occluders;
+
+	//the whole grid can also be culled on the gpu, against the depth of the frame before, with no readback
+	unsigned int hiZVAO;
+	glGenVertexArrays(1, &hiZVAO);
+	glState.bindVertexArray(hiZVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	packedLayout.apply();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glState.bindVertexArray(0);
+
+	HiZCulling hiZ(hiZVAO);
+	hiZ.setInstances(cubeModels, glm::vec3(-0.5f), glm::vec3(0.5f));
+
+	//terrain under the cubes, a chunked voxel world meshed on worker threads with one draw per chunk.
+	//chunks are streamed in and out around the camera, so it goes on as far as you walk
+	ThreadPool workers;
+	VoxelWorld world(workers);
+	world.setUpdateLimit(8);
+	ChunkStreamer streamer(world, workers);
+
+	Shader voxelShader("staticVertexShader.vs", "fragmentShader.fs");
+	voxelShader.use();
+	voxelShader.setInt("ourTexture1", 0);
+	voxelShader.setInt("ourTexture2", 1);
+
+	//a wall of crates along the row of spheres. it only ever changes when its gate slides, so it is baked into one
+	//world space buffer and drawn with one call instead of being culled crate by crate like the grid
+	StaticBatchBuilder staticScenery;
+	unsigned int wallMaterial = staticScenery.addMaterial(&voxelShader, { texture1, texture2 });
+	unsigned int crateMesh = staticScenery.addMesh(vertices, 36);
+	std::vector<unsigned int> gateCrates;
+	std::vector<glm::vec3> gatePositions;
+	for (int z = 2; z >= -20; z--) {
+		for (int y = 0; y < 2; y++) {
+			glm::vec3 position(-8.0f, (float)y, (float)z);
+			unsigned int crate = staticScenery.addObject(crateMesh, wallMaterial, glm::translate(glm::mat4(1.0f), position));
+			if (z == -6 || z == -7) {
+				gateCrates.push_back(crate);
+				gatePositions.push_back(position);
+			}
+		}
+	}
+	staticScenery.update();
+	bool gateOpen = false;
+	bool editHeld = false;
+
+	//movement runs in fixed steps at SIMULATION_RATE, and the camera is drawn between the last two of them
+	const double SIMULATION_RATE = 60.0;
+	FixedTimestep simulation(SIMULATION_RATE);
+	glm::vec3 simulatedPosition = camera.Position, previousPosition = camera.Position;
+
+	glState.setDepthTest(true);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// main render loop
@@ -248,59 +477,199 @@ int main() {
 		deltaTime = currentframe - lastFrame;
 		lastFrame = currentframe;
 
-		processInput(window);
+		InputFrame frame = input.takeFrame();
+		processInput(window, frame);
+
+		//however long the frame took, the simulation only ever moves in steps of the same length
+		unsigned int steps = simulation.advance(deltaTime);
+		for (unsigned int i = 0; i < steps; i++) {
+			previousPosition = simulatedPosition;
+			camera.SetPosition(simulatedPosition);
+			simulate(frame, simulation.step());
+			simulatedPosition = camera.Position;
+		}
+		//blending two equal positions does not always give that position back exactly, which would count a camera standing still as moved
+		if (previousPosition == simulatedPosition)
+			camera.SetPosition(simulatedPosition);
+		else
+			camera.SetPosition(glm::mix(previousPosition, simulatedPosition, simulation.alpha()));
+
+		//left click digs out the block in the middle of the screen, right click puts one back in front of it
+		bool digDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+		bool placeDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+		if ((digDown || placeDown) && !editHeld) {
+			//the cubes are picked through their BVH first, a cube in front of the terrain stops the click from editing behind it
+			BVHRayHit picked = cubeBVH.raycast(camera.Position, camera.Front, 8.0f);
+			glm::ivec3 hit, before;
+			if (world.raycast(camera.Position, camera.Front, picked.distance, hit, before)) {
+				if (digDown)
+					world.setBlock(hit.x, hit.y, hit.z, BLOCK_AIR);
+				else
+					world.setBlock(before.x, before.y, before.z, BLOCK_STONE);
+			}
+		}
+		editHeld = digDown || placeDown;
+
+		//moving the gate only marks the wall's batch dirty, update() rebakes it and nothing else
+		if (wallGateOpen != gateOpen) {
+			gateOpen = wallGateOpen;
+			glm::vec3 slide = gateOpen ? glm::vec3(-1.0f, 0.0f, 0.0f) : glm::vec3(0.0f);
+			for (unsigned int g = 0; g < gateCrates.size(); g++)
+				staticScenery.moveObject(gateCrates[g], glm::translate(glm::mat4(1.0f), gatePositions[g] + slide));
+		}
+		staticScenery.update();
+		bool cpuBudgetExceeded = streamer.stats().cpuBudgetExceeded;
+		bool gpuBudgetExceeded = streamer.stats().gpuBudgetExceeded;
+		streamer.update(camera.Position, camera.Front);
+		if (streamer.stats().cpuBudgetExceeded && !cpuBudgetExceeded)
+			std::cout << "chunks in view exceed the cpu budget: " << world.cpuBytes() / (1 << 20) << " MB" << std::endl;
+		if (streamer.stats().gpuBudgetExceeded && !gpuBudgetExceeded)
+			std::cout << "chunk meshes in view exceed the gpu budget: " << world.gpuBytes() / (1 << 20) << " MB" << std::endl;
+		world.update();
 
 		//render
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		//uses the shaderprogram made
 		ourShader.use();
 		ourShader.setFloat("offset", 0.0);
-		glBindVertexArray(VAO);
-		
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
 		ourShader.setFloat("mixer", mixVal);
+		//the VAO and both textures are bound by the batch renderer through glState, so they only reach the driver once
 
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+		const glm::mat4& viewProjection = camera.GetViewProjectionMatrix();
 
-		glm::mat4 view = camera.GetViewMatrix();
+		if (camera.GetVersion() != uploadedCameraVersion) {
+			cameraUniforms.update(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.Position, currentframe);
+			uploadedCameraVersion = camera.GetVersion();
+		}
+		else {
+			cameraUniforms.updateTime(currentframe);
+		}
 
-		ourShader.setMat4("projection", projection);
-		ourShader.setMat4("view", view);
+		//the sphere levels follow the camera whichever way the cubes are culled
+		bool levelsChanged = false;
+		if (camera.GetVersion() != lodVersion) {
+			lodVersion = camera.GetVersion();
+			lodSelector.setView(camera.Position, camera.Zoom, camera.GetViewportHeight());
+			for (unsigned int i = 0; i < sphereModels.size(); i++) {
+				unsigned int level = lodSelector.select(sphereMesh, glm::vec3(sphereModels[i][3]), SPHERE_SCALE, sphereLevels[i]);
+				levelsChanged = levelsChanged || level != sphereLevels[i];
+				sphereLevels[i] = level;
+			}
+		}
+
+		//requeues the batch only when a different set of cubes is in view or a sphere changed its level
+		bool requeue = !batchQueued || levelsChanged;
+		//while gpu culling is off the pyramid is not rebuilt, and the world may change under it
+		if (hiZActive && !gpuCullingEnabled)
+			hiZ.invalidate();
+		hiZActive = gpuCullingEnabled;
+		if (gpuCullingEnabled) {
+			hiZ.cull(viewProjection);
+			cpuCullVersion = 0;
+			//the cubes are drawn from the survivors, the batch keeps only the spheres
+			if (!lastVisibleCubes.empty()) {
+				lastVisibleCubes.clear();
+				requeue = true;
+			}
+		}
+		else if (camera.GetVersion() != cpuCullVersion) {
+			cpuCullVersion = camera.GetVersion();
+			visibleCubes.clear();
+			cubeBVH.frustumQuery(camera.GetFrustum(), visibleCubes);
+
+			occluders = visibleCubes;
+			auto closerToCamera = [&](unsigned int a, unsigned int b) {
+				glm::vec3 toA = glm::vec3(cubeModels[a][3]) - camera.Position, toB = glm::vec3(cubeModels[b][3]) - camera.Position;
+				return glm::dot(toA, toA) < glm::dot(toB, toB);
+			};
+			unsigned int occluderCount = std::min(OCCLUDER_COUNT, (unsigned int)occluders.size());
+			std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end(), closerToCamera);
+
+			occlusion.begin(viewProjection);
+			for (unsigned int i = 0; i < occluderCount; i++)
+				occlusion.renderOccluderBox(cubeMins[occluders[i]], cubeMaxs[occluders[i]]);
+			occlusion.finish();
+			visibleCubes.erase(std::remove_if(visibleCubes.begin(), visibleCubes.end(),
+				[&](unsigned int cube) { return !occlusion.isVisible(cubeMins[cube], cubeMaxs[cube]); }), visibleCubes.end());
+
+			if (visibleCubes != lastVisibleCubes) {
+				lastVisibleCubes.swap(visibleCubes);
+				requeue = true;
+			}
+		}
+
+		if (requeue) {
+			batch.clear();
+			for (unsigned int cube : lastVisibleCubes)
+				batch.submit(containerMaterial, cubeFirst, cubeCount, cubeModels[cube]);
+			for (unsigned int i = 0; i < sphereModels.size(); i++) {
+				const LODLevel& level = sphereMesh.levels[sphereLevels[i]];
+				batch.submit(containerMaterial, level.first, level.count, sphereModels[i]);
+			}
+			batchQueued = true;
+		}
 
 		
-		//ourShader.setMat4("transform", trans);
-		
-		for (unsigned int i = 0; i < 10; i++) {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float xvalue = 0.0f;
-
-			float angle = 0.0f;
-			model = glm::rotate(model,  glm::radians(angle) , glm::vec3(0.5f, 1.0f, 0.0f));
-			ourShader.setMat4("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-			
-			for (unsigned int j = 0; j < 32; j++) {
-
-				//creating more containgers above the originals and fake
-				glm::mat4  trans = glm::mat4(1.0f);
-				trans = glm::translate(trans, cubePositions[i] + glm::vec3(0.0f + xvalue, 1.0f, 0.0f));
-				ourShader.setMat4("model", trans);
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-				xvalue += 1.0f;
-
-				//creating more containers on the side of the original
-				trans = glm::mat4(1.0f);
-				trans = glm::translate(trans, cubePositions[i] + glm::vec3(0.0f + xvalue, 0.0f, 0.0f));
-				ourShader.setMat4("model", trans);
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-				
+		//reports how much the last mode shaded when switching the depth pre-pass on or off
+		if (prepass.isEnabled() != depthPrepassEnabled) {
+			std::cout << "shaded fragments per pixel " << (prepass.isEnabled() ? "with" : "without") << " depth pre-pass: "
+				<< prepass.shadedFragmentsPerPixel(camera.GetViewportWidth(), camera.GetViewportHeight()) << std::endl;
+			prepass.setEnabled(depthPrepassEnabled);
+		}
+
+		//the scene is drawn into targets of the frame graph and resolved into the window, post effects go in between.
+		//the graph clears the targets on their first write and hands them out from a pool that follows the window size
+		batch.sortFrontToBack(camera.Position);
+		int viewportWidth = camera.GetViewportWidth(), viewportHeight = camera.GetViewportHeight();
+		frameGraph.reset();
+		FrameGraphResource backbuffer = frameGraph.importBackbuffer("backbuffer", viewportWidth, viewportHeight);
+		FrameGraphResource sceneColor = 0, sceneDepth = 0;
+		frameGraph.addPass("scene", [&](FrameGraphBuilder& builder) {
+			//depth and stencil like the window's, so the depth can be blitted into it
+			sceneColor = builder.write(builder.create("scene color", { viewportWidth, viewportHeight, GL_RGBA8 }));
+			sceneDepth = builder.write(builder.create("scene depth", { viewportWidth, viewportHeight, GL_DEPTH24_STENCIL8 }));
+		}, [&](const FrameGraphContext&) {
+			//terrain goes first, so it is in the depth the cubes are tested and pre-passed against
+			voxelShader.use();
+			voxelShader.setFloat("mixer", mixVal);
+			glState.bindTexture(0, texture1);
+			glState.bindTexture(1, texture2);
+			world.draw(camera.GetFrustum());
+			staticScenery.draw();
+
+			//draws every visible cube and sphere front to back, one call per material and pass
+			if (gpuCullingEnabled) {
+				prepass.render([&](Shader* override) {
+					(override ? override : &ourShader)->use();
+					glState.bindTexture(0, texture1);
+					glState.bindTexture(1, texture2);
+					hiZ.draw(cubeFirst, cubeCount);
+					batch.flush(override);
+				});
 			}
+			else {
+				prepass.render([&batch](Shader* override) { batch.flush(override); });
+			}
+		});
+		frameGraph.addPass("resolve", [&](FrameGraphBuilder& builder) {
+			builder.read(sceneColor);
+			builder.read(sceneDepth);
+			builder.write(backbuffer);
+		}, [&](const FrameGraphContext& context) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, context.framebuffer({ sceneColor, sceneDepth }));
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, viewportWidth, viewportHeight, 0, 0, viewportWidth, viewportHeight, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			//the pyramid is built from the window's depth, which only holds the scene once it is resolved
+			if (gpuCullingEnabled)
+				hiZ.buildPyramid(viewportWidth, viewportHeight, viewProjection);
+		});
+		//a minimized window has no size to make targets of
+		if (viewportWidth > 0 && viewportHeight > 0) {
+			frameGraph.compile();
+			frameGraph.execute();
 		}
 	
 		 
@@ -311,8 +680,21 @@ int main() {
 
 	//deletes shader program and buffers after they have been linked.
 	ourShader.discard();
-	glDeleteVertexArrays(1, &VAO);
+	glState.deleteVertexArray(VAO);
+	glState.deleteVertexArray(hiZVAO);
+	glState.deleteTexture(texture1);
+	glState.deleteTexture(texture2);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	batch.discard();
+	cameraUniforms.discard();
+	prepass.discard();
+	frameGraph.discard();
+	hiZ.discard();
+	voxelShader.discard();
+	staticScenery.discard();
+	streamer.discard();
+	world.discard();
 
 	glfwTerminate();
 	return 0;
@@ -322,65 +704,79 @@ int main() {
 // Callback function that resizes the viewport of OpenGL context if window is resized
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
+	camera.SetViewport(width, height);
 }
 
 //callback function that deals with input, such as keystrokes etc.
-void processInput(GLFWwindow* window) {
+void processInput(GLFWwindow* window, const InputFrame& frame) {
 
 	const float cameraSpeed = 5.0f * deltaTime;;
 
-	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	if (frame.isDown(GLFW_KEY_1)) {
+		glState.setPolygonMode(GL_LINE);
+	}
+	if (frame.isDown(GLFW_KEY_2)) {
+		glState.setPolygonMode(GL_FILL);
+	}
+	if (frame.isDown(GLFW_KEY_3)) {
+		depthPrepassEnabled = true;
+	}
+	if (frame.isDown(GLFW_KEY_4)) {
+		depthPrepassEnabled = false;
 	}
-	if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
-		glPolygonMode(GL_FILL, GL_LINE);
+	if (frame.isDown(GLFW_KEY_5)) {
+		gpuCullingEnabled = true;
 	}
+	if (frame.isDown(GLFW_KEY_6)) {
+		gpuCullingEnabled = false;
+	}
+	if (frame.wasPressed(GLFW_KEY_7))
+		wallGateOpen = !wallGateOpen;
 	//shuts down window if escape key is pressed
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (frame.isDown(GLFW_KEY_ESCAPE))
 		glfwSetWindowShouldClose(window, true);
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-		mixVal += 0.001f;
+
+	//every cursor and scroll event since the last frame, summed, so the camera vectors are rebuilt once
+	camera.ProcessMouseMovement(frame.cursorX, frame.cursorY);
+	if (frame.scroll != 0.0f)
+		camera.ProcessMouseScroll(frame.scroll);
+	if (frame.wasPressed(GLFW_KEY_Q))
+		camera.SetQuaternionOrientation(!camera.UsesQuaternionOrientation());
+}
+
+//one fixed step of everything that moves over time, dt is the same every call
+void simulate(const InputFrame& frame, float dt) {
+	if (frame.isDown(GLFW_KEY_UP)) {
+		mixVal += 0.06f * dt;
 		if (mixVal >= 1.0f) {
 			mixVal = 1.0f;
 		}
 	}
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-		mixVal -= 0.001f;
+	if (frame.isDown(GLFW_KEY_DOWN)) {
+		mixVal -= 0.06f * dt;
 		if (mixVal <= 0.0f) {
 			mixVal = 0.0f;
 		}
 		
 	}
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		camera.ProcessKeyboard(FORWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		camera.ProcessKeyboard(BACKWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		camera.ProcessKeyboard(LEFT, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		camera.ProcessKeyboard(RIGHT, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-		camera.ProcessKeyboard(UP, deltaTime);
+	if (frame.isDown(GLFW_KEY_W))
+		camera.ProcessKeyboard(FORWARD, dt);
+	if (frame.isDown(GLFW_KEY_S))
+		camera.ProcessKeyboard(BACKWARD, dt);
+	if (frame.isDown(GLFW_KEY_A))
+		camera.ProcessKeyboard(LEFT, dt);
+	if (frame.isDown(GLFW_KEY_D))
+		camera.ProcessKeyboard(RIGHT, dt);
+	if (frame.isDown(GLFW_KEY_SPACE))
+		camera.ProcessKeyboard(UP, dt);
 }
 
 void mouse_callback(GLFWwindow* window, double posX, double posY) {
-	float FposX = static_cast<float>(posX);
-	float FposY = static_cast<float>(posY);
-	
-	if (firstMouse) {
-		lastX = FposX;
-		lastY = FposY;
-		firstMouse = false;
-	}
-
-	float xoffset = FposX - lastX;
-	float yoffset = lastY - FposY;
-
-	lastX = FposX;
-	lastY = FposY;
-	
-	camera.ProcessMouseMovement(xoffset, yoffset);
+	input.cursorMoved(posX, posY);
 }
 void scroll_callback(GLFWwindow* window, double posX, double posY) {
-	camera.ProcessMouseScroll(posY);
-}
\ No newline at end of file
+	input.scrolled(posY);
+}
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	input.keyChanged(key, action);
+}
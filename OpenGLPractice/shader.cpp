@@ -1,64 +1,72 @@
 #include "shader.h"
+#include "GLStateCache.h"
+#include "CameraUniforms.h"
+
+namespace {
+	std::string readShaderFile(const char* path) {
+		std::ifstream shaderFile;
+		shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+		try {
+			shaderFile.open(path);
+
+			std::stringstream shaderStream;
+			shaderStream << shaderFile.rdbuf();
+			shaderFile.close();
+
+			return shaderStream.str();
+		}
+		catch(std::ifstream::failure& e) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ\n" <<std::endl;
+		}
+		return std::string();
+	}
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
-{
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	try {
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-
-		std::stringstream vShaderStream, fShaderStream;
+	unsigned int compileShader(GLenum type, const char* path, const char* stageName) {
+		std::string code = readShaderFile(path);
+		const char* shaderCode = code.c_str();
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+		int success;
+		char infoLog[512];
 
-		vShaderFile.close();
-		fShaderFile.close();
+		unsigned int shader = glCreateShader(type);
+		glShaderSource(shader, 1, &shaderCode, NULL);
+		glCompileShader(shader);
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch(std::ifstream::failure& e) {
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ\n" <<std::endl;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+		return shader;
 	}
+}
 
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : Shader(vertexPath, nullptr, fragmentPath)
+{
+}
 
-	unsigned int vertex, fragment;
+Shader::Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, const std::vector<const char*>& feedbackVaryings)
+{
+	unsigned int vertex, geometry = 0, fragment = 0;
 	int success;
 	char infoLog[512];
 
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
-
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
+	vertex = compileShader(GL_VERTEX_SHADER, vertexPath, "VERTEX");
+	if (geometryPath)
+		geometry = compileShader(GL_GEOMETRY_SHADER, geometryPath, "GEOMETRY");
+	if (fragmentPath)
+		fragment = compileShader(GL_FRAGMENT_SHADER, fragmentPath, "FRAGMENT");
 
 	Shader::ID = glCreateProgram();
 	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
+	if (geometry)
+		glAttachShader(ID, geometry);
+	if (fragment)
+		glAttachShader(ID, fragment);
+	// has to be set before linking
+	if (!feedbackVaryings.empty())
+		glTransformFeedbackVaryings(ID, (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
 	glLinkProgram(ID);
 
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -68,14 +76,22 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	}
 
 	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	if (geometry)
+		glDeleteShader(geometry);
+	if (fragment)
+		glDeleteShader(fragment);
+
+	// hooks the program up to the shared camera uniform buffer if it uses it
+	unsigned int cameraBlock = glGetUniformBlockIndex(ID, "CameraData");
+	if (cameraBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, cameraBlock, CAMERA_UBO_BINDING);
 }
 
 void Shader::use() {
-	glUseProgram(ID);
+	glState.useProgram(ID);
 }
 void Shader::discard() {
-	glDeleteProgram(ID);
+	glState.deleteProgram(ID);
 }
 void Shader::setBool(const std::string& name, bool value) const {
 	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int) value);
@@ -89,6 +105,10 @@ void Shader::setFloat(const std::string& name, float value) const {
 	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
 
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
+	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
 void Shader::setMat4(const std::string& name, glm::mat4 value) const {
 	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()),1, GL_FALSE, glm::value_ptr(value));
 
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include "glm\glm\glm.hpp"
 #include "glm\glm\gtc\matrix_transform.hpp"
 #include "glm\glm\gtc\type_ptr.hpp"
@@ -17,6 +18,8 @@ public:
 	unsigned int ID;
 
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// geometryPath and fragmentPath may be null. feedbackVaryings are captured interleaved by transform feedback
+	Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, const std::vector<const char*>& feedbackVaryings = {});
 
 	void use();
 	void discard();
@@ -24,6 +27,7 @@ public:
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
+	void setVec3(const std::string& name, const glm::vec3& value) const;
 	void setMat4(const std::string& name, glm::mat4 value) const;
 };
 
@@ -0,0 +1,20 @@
+#version 330 core
+
+// vertex shader for geometry whose positions are already in world space, like the voxel chunk meshes and baked static batches
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTex;
+
+out vec2 TexCoord;
+
+layout (std140) uniform CameraData {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProj;
+	vec4 cameraPos;
+	float time;
+};
+
+void main(){
+	gl_Position = viewProj * vec4(aPos, 1.0);
+	TexCoord = aTex;
+}
\ No newline at end of file
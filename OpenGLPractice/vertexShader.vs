@@ -2,14 +2,23 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
+// per instance model matrix, takes up locations 2 to 5 (one vec4 column each)
+layout (location = 2) in mat4 aModel;
 
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// the depth pre-pass and the shading pass must produce bit identical depth for GL_EQUAL to pass
+invariant gl_Position;
+
+layout (std140) uniform CameraData {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProj;
+	vec4 cameraPos;
+	float time;
+};
 
 void main(){
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProj * aModel * vec4(aPos, 1.0);
 	TexCoord = aTex;
 }
\ No newline at end of file